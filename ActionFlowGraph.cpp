@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <ciso646>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+#include "ActionFlowGraph.hpp"
+#include "Util.hpp"
+
+namespace Apt::ActionFlow {
+
+using namespace AptTypes;
+
+bool isBranch(const std::string_view typeName) {
+    return typeName.find("Branch") == 0;
+}
+
+bool isFunctionDefinition(const std::string_view typeName) {
+    return typeName.find("DefineFunction") == 0;
+}
+
+bool endsFlow(const std::string_view typeName) {
+    return typeName == "End" or typeName == "Return" or typeName == "Throw";
+}
+
+Address branchDestination(const Address address, const AptType& branch) {
+    const auto offset = branch.at("offset").getNumericValue<std::int32_t>();
+    return static_cast<Address>(address + branch.size() + offset);
+}
+
+Address functionBodyEnd(const Address address, const AptType& definition) {
+    const auto size = definition.at("size").getNumericValue<std::uint32_t>();
+    return static_cast<Address>(address + definition.size() + size);
+}
+
+FlowGraph buildFlowGraph(const AptObjectPool& pool, const Address streamBegin) {
+    auto graph = FlowGraph{};
+    graph.begin = streamBegin;
+    graph.end = pool.arrays.at(streamBegin);
+    const auto first = pool.objectInstances.lower_bound(graph.begin);
+    const auto last = pool.objectInstances.lower_bound(graph.end);
+    for (auto current = first; current != last; ++current) {
+        const auto& [address, object] = *current;
+        if (object.baseTypeName == "Instruction") {
+            graph.instructions.push_back(Instruction{ address, &object });
+        }
+    }
+
+    const auto count = graph.instructions.size();
+    graph.instructionIndices.reserve(count);
+    for (auto i = std::size_t{ 0 }; i < count; ++i) {
+        graph.instructionIndices.emplace(graph.instructions[i].address, i);
+    }
+    // past the end of the stream is index count
+    const auto indexOf = [&graph, count](const Address target, const Instruction& from) {
+        if (target == graph.end) {
+            return count;
+        }
+        const auto index = graph.instructionAt(target);
+        if (index == none) {
+            throw std::runtime_error{ asString("Instruction at ", from.address, " leads to ",
+                                               target, ", which is not an instruction of the "
+                                               "action stream at ", graph.begin) };
+        }
+        return index;
+    };
+
+    // one pass finds where blocks start and which function every instruction is in;
+    // function bodies are nested, so the innermost open one is enough
+    auto isLeader = std::vector<bool>(count + 1, false);
+    isLeader[0] = true;
+    auto instructionFunctions = std::vector<std::size_t>(count, none);
+    auto definedFunctions = std::vector<std::size_t>(count, none);
+    // where each branch leads, or past the body of each DefineFunction
+    auto targets = std::vector<std::size_t>(count, count);
+    auto openFunctions = std::vector<std::size_t>{};
+    for (auto i = std::size_t{ 0 }; i < count; ++i) {
+        const auto& [address, object] = graph.instructions[i];
+        while (not openFunctions.empty() and
+               graph.functions[openFunctions.back()].end <= address) {
+            openFunctions.pop_back();
+        }
+        const auto function = openFunctions.empty() ? none : openFunctions.back();
+        instructionFunctions[i] = function;
+
+        if (isFunctionDefinition(object->typeName)) {
+            const auto bodyEnd = functionBodyEnd(address, *object);
+            if (function != none and bodyEnd > graph.functions[function].end) {
+                throw std::runtime_error{ asString("The body of the function defined at ",
+                                                   address, " overlaps the end of its "
+                                                   "enclosing function") };
+            }
+            isLeader[i + 1] = true;
+            targets[i] = indexOf(bodyEnd, graph.instructions[i]);
+            isLeader[targets[i]] = true;
+            definedFunctions[i] = graph.functions.size();
+            graph.functions.push_back(FunctionBody{
+                i, static_cast<Address>(address + object->size()), bodyEnd, none, function });
+            openFunctions.emplace_back(definedFunctions[i]);
+        }
+        else if (isBranch(object->typeName)) {
+            targets[i] = indexOf(branchDestination(address, *object), graph.instructions[i]);
+            isLeader[targets[i]] = true;
+            isLeader[i + 1] = true;
+        }
+        else if (endsFlow(object->typeName)) {
+            isLeader[i + 1] = true;
+        }
+    }
+
+    graph.blockOf.resize(count);
+    for (auto i = std::size_t{ 0 }; i < count; ++i) {
+        if (isLeader[i]) {
+            graph.blocks.push_back(BasicBlock{ i, 0, instructionFunctions[i], {}, {} });
+        }
+        graph.blocks.back().instructionCount += 1;
+        graph.blockOf[i] = graph.blocks.size() - 1;
+    }
+    for (auto& function : graph.functions) {
+        if (function.begin != function.end) {
+            function.entryBlock = graph.blockOf[graph.instructionAt(function.begin)];
+        }
+    }
+
+    for (auto& block : graph.blocks) {
+        const auto lastIndex = block.firstInstruction + block.instructionCount - 1;
+        const auto* object = graph.instructions[lastIndex].object;
+        const auto link = [&graph, &block, count](const std::size_t target) {
+            if (target == count) {
+                return;
+            }
+            const auto successor = graph.blockOf[target];
+            if (std::find(block.successors.begin(), block.successors.end(), successor) ==
+                block.successors.end()) {
+                block.successors.emplace_back(successor);
+            }
+        };
+        // falling off the end of a function body returns
+        const auto fallThrough = [&] {
+            const auto next = lastIndex + 1;
+            if (next < count and instructionFunctions[next] == block.function) {
+                link(next);
+            }
+        };
+
+        if (isFunctionDefinition(object->typeName)) {
+            link(targets[lastIndex]);
+        }
+        else if (isBranch(object->typeName)) {
+            link(targets[lastIndex]);
+            if (object->typeName != "BranchAlways") {
+                fallThrough();
+            }
+        }
+        else if (not endsFlow(object->typeName)) {
+            fallThrough();
+        }
+    }
+    for (auto i = std::size_t{ 0 }; i < graph.blocks.size(); ++i) {
+        for (const auto successor : graph.blocks[i].successors) {
+            graph.blocks[successor].predecessors.emplace_back(i);
+        }
+    }
+
+    // only the first instruction of a block can be jumped to
+    const auto typeOf = [&graph](const std::size_t i) {
+        return std::string_view{ graph.instructions[i].object->typeName };
+    };
+    const auto targetOf = [&targets](const std::size_t i) { return targets[i]; };
+    const auto reachable = findReachableInstructions(count, typeOf, targetOf);
+    for (auto& block : graph.blocks) {
+        block.reachable = reachable[block.firstInstruction];
+    }
+    return graph;
+}
+
+} // namespace Apt::ActionFlow
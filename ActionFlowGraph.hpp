@@ -0,0 +1,149 @@
+#pragma once
+#include <cstddef>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AptTypes.hpp"
+
+// Control flow graph of one action stream, as read by readInstructions.
+//
+// Blocks start at the first instruction, at every branch destination, after every
+// branch, End, Return and Throw, and at the beginning and past the end of every
+// function body. A DefineFunction does not run its body: its successor is the
+// instruction past the body, and the body is a function of its own whose entry
+// block is reachable once the DefineFunction is. Falling off the end of a body
+// returns, so no edge leaves a function.
+namespace Apt::ActionFlow {
+
+using AptTypes::Address;
+
+constexpr auto none = (std::numeric_limits<std::size_t>::max)();
+
+struct BasicBlock {
+    std::size_t firstInstruction; // index into FlowGraph::instructions
+    std::size_t instructionCount;
+    std::size_t function;         // index into FlowGraph::functions, none at top level
+    std::vector<std::size_t> successors;
+    std::vector<std::size_t> predecessors;
+    bool reachable = false;
+};
+
+struct FunctionBody {
+    std::size_t definition;  // instruction index of the DefineFunction / DefineFunction2
+    Address begin;           // first instruction of the body
+    Address end;             // past the last instruction of the body
+    std::size_t entryBlock;  // none for an empty body
+    std::size_t parent;      // enclosing function, none at top level
+};
+
+struct Instruction {
+    Address address;
+    const AptTypes::AptType* object; // owned by the pool
+};
+
+struct FlowGraph {
+    Address begin = 0;
+    Address end = 0;
+    std::vector<Instruction> instructions; // in address order
+    std::vector<BasicBlock> blocks;        // in address order
+    std::vector<FunctionBody> functions;   // in order of their definition
+    std::vector<std::size_t> blockOf;      // block index of each instruction
+
+    // none if no instruction starts at address
+    std::size_t instructionAt(const Address address) const {
+        const auto found = this->instructionIndices.find(address);
+        return found == this->instructionIndices.end() ? none : found->second;
+    }
+
+    Address addressOf(const BasicBlock& block) const {
+        return this->instructions[block.firstInstruction].address;
+    }
+
+    const AptTypes::AptType& lastInstructionOf(const BasicBlock& block) const {
+        return *this->instructions[block.firstInstruction + block.instructionCount - 1].object;
+    }
+
+    std::unordered_map<Address, std::size_t> instructionIndices;
+};
+
+// the same tests as readInstructions and getDestinationMap
+bool isBranch(std::string_view typeName);
+bool isFunctionDefinition(std::string_view typeName);
+// End, Return and Throw: nothing after them runs
+bool endsFlow(std::string_view typeName);
+
+// which of count instructions can run, starting from the first one, by the rules
+// of buildFlowGraph; for code which keeps instructions as something else than pool
+// objects. typeOf(i) is the type name of instruction i, targetOf(i) the index of
+// the destination of a branch, or of the first instruction past the body of a
+// DefineFunction, count for the end of the stream
+template <typename TypeOf, typename TargetOf>
+std::vector<bool> findReachableInstructions(const std::size_t count,
+                                            const TypeOf& typeOf,
+                                            const TargetOf& targetOf) {
+    // past the innermost function body around each instruction; bodies are nested
+    auto bodyEnds = std::vector<std::size_t>(count, count);
+    auto openBodyEnds = std::vector<std::size_t>{};
+    for (auto i = std::size_t{ 0 }; i < count; ++i) {
+        while (not openBodyEnds.empty() and openBodyEnds.back() <= i) {
+            openBodyEnds.pop_back();
+        }
+        bodyEnds[i] = openBodyEnds.empty() ? count : openBodyEnds.back();
+        if (isFunctionDefinition(typeOf(i))) {
+            openBodyEnds.emplace_back(targetOf(i));
+        }
+    }
+
+    auto reachable = std::vector<bool>(count, false);
+    auto pending = std::vector<std::size_t>{};
+    const auto reach = [count, &pending](const std::size_t index) {
+        if (index < count) {
+            pending.emplace_back(index);
+        }
+    };
+    reach(0);
+    while (not pending.empty()) {
+        const auto i = pending.back();
+        pending.pop_back();
+        if (reachable[i]) {
+            continue;
+        }
+        reachable[i] = true;
+        // falling off the end of a function body returns
+        const auto fallThrough = [&] {
+            if (i + 1 < bodyEnds[i]) {
+                reach(i + 1);
+            }
+        };
+        const auto type = typeOf(i);
+        if (isFunctionDefinition(type)) {
+            // the body is entered once its DefineFunction is reached
+            reach(i + 1);
+            reach(targetOf(i));
+        }
+        else if (isBranch(type)) {
+            reach(targetOf(i));
+            if (type != "BranchAlways") {
+                fallThrough();
+            }
+        }
+        else if (not endsFlow(type)) {
+            fallThrough();
+        }
+    }
+    return reachable;
+}
+
+// where a Branch instruction at address goes if it jumps
+Address branchDestination(Address address, const AptTypes::AptType& branch);
+// the first address past the body of a DefineFunction at address
+Address functionBodyEnd(Address address, const AptTypes::AptType& definition);
+
+// in time linear in the number of instructions; throws if a branch or a function
+// body does not end at an instruction of the stream
+FlowGraph buildFlowGraph(const AptTypes::AptObjectPool& pool, Address streamBegin);
+
+} // namespace Apt::ActionFlow
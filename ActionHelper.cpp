@@ -2,417 +2,135 @@
 
 void ActionHelper::AddAction(action_type action, ActionBytes *ab)
 {
-	unsigned char c = (unsigned char)action;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::AddIntAction(action_type action, ActionBytes *ab, int actionvalue)
 {
-	unsigned char c = (unsigned char)action;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	unsigned int x = GETALIGN(ab->actionbytecount);
-	c = 0;
-	for (unsigned int i = 0; i < x; i++)
-	{
-		ab->actionbytes << c;
-		ab->actionbytecount++;
-	}
-	c = GetByte(actionvalue, 0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(actionvalue, 1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(actionvalue, 2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(actionvalue, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytes.alignTo(4);
+	ab->actionbytes.append((int32_t)actionvalue);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::AddStringAction(action_type action, ActionBytes *ab, const char *actionstring)
 {
-	unsigned char c = (unsigned char)action;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	unsigned int x = GETALIGN(ab->actionbytecount);
-	c = 0;
-	for (unsigned int i = 0; i < x; i++)
-	{
-		ab->actionbytes << c;
-		ab->actionbytecount++;
-	}
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytes.alignTo(4);
 	ActionString *s = new ActionString;
-	s->stringoffset = ab->actionbytecount;
+	s->stringoffset = ab->actionbytes.size();
 	s->string = _strdup(actionstring);
 	ab->actionstrings.push_back(s);
 	ab->stringcount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
+	ab->actionbytes.appendZeros(4);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::AddByteAction(action_type action, ActionBytes *ab, unsigned char number)
 {
-	unsigned char c = (unsigned char)action;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << number;
-	ab->actionbytecount++;
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytes.append((uint8_t)number);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::AddShortAction(action_type action, ActionBytes *ab, unsigned short number)
 {
-	unsigned char c = (unsigned char)action;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << GetByte(number, 0);
-	ab->actionbytecount++;
-	ab->actionbytes << GetByte(number, 1);
-	ab->actionbytecount++;
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytes.append((uint16_t)number);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::AddFloatAction(action_type action, ActionBytes *ab, float number)
 {
-	unsigned char c = (unsigned char)action;
-	unsigned int n = *(unsigned int*)&number;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(n, 0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(n, 1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(n, 2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(n, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytes.append(number);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::AddLongAction(action_type action, ActionBytes *ab, unsigned long number)
 {
-	unsigned char c = (unsigned char)action;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(number, 0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(number, 1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(number, 2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(number, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytes.append((uint32_t)number);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::AddURLAction(action_type action, ActionBytes *ab, const char *str1, const char *str2)
 {
-	unsigned char c = (unsigned char)action;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	unsigned int x = GETALIGN(ab->actionbytecount);
-	c = 0;
-	for (unsigned int i = 0; i < x; i++)
-	{
-		ab->actionbytes << c;
-		ab->actionbytecount++;
-	}
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytes.alignTo(4);
 	
 	ActionString *s = new ActionString;
-	s->stringoffset = ab->actionbytecount;
+	s->stringoffset = ab->actionbytes.size();
 	s->string = _strdup(str1);
 	ab->actionstrings.push_back(s);
 	ab->stringcount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
+	ab->actionbytes.appendZeros(4);
 	ActionString *s2 = new ActionString;
-	s2->stringoffset = ab->actionbytecount;
+	s2->stringoffset = ab->actionbytes.size();
 	s2->string = _strdup(str2);
 	ab->actionstrings.push_back(s2);
 	ab->stringcount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
+	ab->actionbytes.appendZeros(4);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::AddConstantPoolAction(action_type action, ActionBytes *ab, unsigned int constantcount)
 {
-	unsigned char c = (unsigned char)action;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	unsigned int x = GETALIGN(ab->actionbytecount);
-	c = 0;
-	for (unsigned int i = 0; i < x; i++)
-	{
-		ab->actionbytes << c;
-		ab->actionbytecount++;
-	}
-	c = GetByte(constantcount, 0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(constantcount, 1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(constantcount, 2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(constantcount, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = 0;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytes.alignTo(4);
+	ab->actionbytes.append((uint32_t)constantcount);
+	ab->actionbytes.appendZeros(4);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::AddDefineFunction2Action(action_type action, ActionBytes *ab, ActionDefineFunction2 *pd, unsigned int flags, unsigned int size, const char *name)
 {
-	unsigned char c = (unsigned char)action;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	unsigned int x = GETALIGN(ab->actionbytecount);
-	c = 0;
-	for (unsigned int i = 0;i < x;i++)
-	{
-		ab->actionbytes << c;
-		ab->actionbytecount++;
-	}
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytes.alignTo(4);
 	ActionString *s = new ActionString;
-	s->stringoffset = ab->actionbytecount;
+	s->stringoffset = ab->actionbytes.size();
 	s->string = _strdup(name);
 	ab->actionstrings.push_back(s);
 	ab->stringcount++;
-	c = 0;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(pd->argumentcount,0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(pd->argumentcount,1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(pd->argumentcount, 2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(pd->argumentcount, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(flags,0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(flags,1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(flags,2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(flags,3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	pd->definefunction2offset = ab->actionbytecount;
-	c = 0;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(size,0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(size,1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(size,2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(size,3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x98765432,0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x98765432, 1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x98765432, 2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x98765432, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x12345678,0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x12345678, 1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x12345678, 2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x12345678, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
+	ab->actionbytes.appendZeros(4);
+	ab->actionbytes.append((uint32_t)pd->argumentcount);
+	ab->actionbytes.append((uint32_t)flags);
+	pd->definefunction2offset = ab->actionbytes.size();
+	ab->actionbytes.appendZeros(4);
+	ab->actionbytes.append((uint32_t)size);
+	ab->actionbytes.append((uint32_t)0x98765432);
+	ab->actionbytes.append((uint32_t)0x12345678);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::AddDefineFunctionAction(action_type action, ActionBytes *ab, ActionDefineFunction *pd, unsigned int size, const char *name)
 {
-	unsigned char c = (unsigned char)action;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	unsigned int x = GETALIGN(ab->actionbytecount);
-	c = 0;
-	for (unsigned int i = 0; i < x; i++)
-	{
-		ab->actionbytes << c;
-		ab->actionbytecount++;
-	}
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytes.alignTo(4);
 	ActionString *s = new ActionString;
-	s->stringoffset = ab->actionbytecount;
+	s->stringoffset = ab->actionbytes.size();
 	s->string = _strdup(name);
 	ab->actionstrings.push_back(s);
 	ab->stringcount++;
-	c = 0;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(pd->argumentcount, 0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(pd->argumentcount, 1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(pd->argumentcount, 2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(pd->argumentcount, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	pd->definefunctionoffset = ab->actionbytecount;
-	c = 0;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(size, 0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(size, 1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(size, 2);;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(size, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x98765432, 0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x98765432, 1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x98765432, 2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x98765432, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x12345678, 0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x12345678, 1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x12345678, 2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(0x12345678, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
+	ab->actionbytes.appendZeros(4);
+	ab->actionbytes.append((uint32_t)pd->argumentcount);
+	pd->definefunctionoffset = ab->actionbytes.size();
+	ab->actionbytes.appendZeros(4);
+	ab->actionbytes.append((uint32_t)size);
+	ab->actionbytes.append((uint32_t)0x98765432);
+	ab->actionbytes.append((uint32_t)0x12345678);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::AddPushDataAction(action_type action, ActionBytes *ab, ActionPushData *pd)
 {
-	unsigned char c = (unsigned char)action;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	unsigned int x = GETALIGN(ab->actionbytecount);
-	c = 0;
-	for (unsigned int i = 0; i < x; i++)
-	{
-		ab->actionbytes << c;
-		ab->actionbytecount++;
-	}
-	c = GetByte(pd->pushdatacount, 0);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(pd->pushdatacount, 1);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(pd->pushdatacount, 2);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	c = GetByte(pd->pushdatacount, 3);
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	pd->pushdataoffset = ab->actionbytecount;
-	c = 0;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
-	ab->actionbytes << c;
-	ab->actionbytecount++;
+	ab->actionbytes.append((uint8_t)action);
+	ab->actionbytes.alignTo(4);
+	ab->actionbytes.append((uint32_t)pd->pushdatacount);
+	pd->pushdataoffset = ab->actionbytes.size();
+	ab->actionbytes.appendZeros(4);
+	ab->actionbytecount = ab->actionbytes.size();
 }
 
 void ActionHelper::APT_ProcessActions(tinyxml2::XMLDocument& doc,tinyxml2::XMLElement* parent, uint8_t *actions, uint8_t *aptaptdata,  AptConstData* data, uint8_t* aptbuffer)
@@ -1036,79 +754,112 @@ void ActionHelper::APT_ProcessActions(tinyxml2::XMLDocument& doc,tinyxml2::XMLEl
 	} while (action != ACTION_END);
 }
 
+uint32_t ActionHelper::AddConstItem(tinyxml2::XMLElement* entry, AptConstData* data)
+{
+	const char* str = entry->Attribute("string");
+	if (str && data->deduplicate)
+	{
+		auto found = data->stringitems.find(str);
+		if (found != data->stringitems.end())
+		{
+			data->duplicatecount++;
+			data->savedbytes += 8 + STRLENGTH(str); //item entry and string
+			return found->second;
+		}
+		data->stringitems.emplace(str, data->itemcount);
+	}
+
+	AptConstItem* aci = new AptConstItem();
+	if (str)
+	{
+		aci->type = TYPE_STRING;
+		aci->strvalue = str;
+	}
+	else
+	{
+		aci->type = TYPE_NUMBER;
+		aci->numvalue = entry->IntAttribute("integer");
+	}
+
+	data->items.push_back(aci);
+	return data->itemcount++;
+}
+
+//case label for an action element; a name whose hash merely collides with a
+//known one is still rejected as unknown
+#define ACTION_NAME_CASE(name) case HashName(name): if (actionname != name) goto unknown;
+
 void ActionHelper::XML_ProcessActions(tinyxml2::XMLElement* entry, ActionBytes *ab, AptConstData* data)
 {
     tinyxml2::XMLElement* entryt;
 
 	for (entryt = entry->FirstChildElement(); entryt != 0; entryt = entryt->NextSiblingElement())
 	{
-		std::string actionname = entryt->Value();
+		const std::string_view actionname = entryt->Value();
 
-		if (actionname == "branchalways")
+		switch (HashName(actionname))
+		{
+		ACTION_NAME_CASE("branchalways")
 		{
 			unsigned int pos = entryt->IntAttribute("offset");
 			AddIntAction(ACTION_BRANCHALWAYS, ab, pos);
 		}
-		else if (actionname == "branchiftrue")
+		break;
+		ACTION_NAME_CASE("branchiftrue")
 		{
 			unsigned int pos = entryt->IntAttribute("offset");
 			AddIntAction(ACTION_BRANCHIFTRUE, ab, pos);
 		}
-		else if (actionname == "branchiffalse")
+		break;
+		ACTION_NAME_CASE("branchiffalse")
 		{
 			unsigned int pos = entryt->IntAttribute("offset");
 			AddIntAction(EA_BRANCHIFFALSE, ab, pos);
 		}
-		else if (actionname == "gotoframe")
+		break;
+		ACTION_NAME_CASE("gotoframe")
 		{
 			unsigned int pos = entryt->IntAttribute("frame");
 			AddIntAction(ACTION_GOTOFRAME, ab, pos);
 		}
-		else if (actionname == "setregister")
+		break;
+		ACTION_NAME_CASE("setregister")
 		{
 			unsigned int pos = entryt->IntAttribute("reg");
 			AddIntAction(ACTION_SETREGISTER, ab, pos);
 		}
-		else if (actionname == "with")
+		break;
+		ACTION_NAME_CASE("with")
 		{
 			unsigned int pos = entryt->IntAttribute("pos");
 			AddIntAction(ACTION_WITH, ab, pos);
 		}
-		else if (actionname == "gotoexpression")
+		break;
+		ACTION_NAME_CASE("gotoexpression")
 		{
 			unsigned int pos = entryt->IntAttribute("pos");
 			AddIntAction(ACTION_GOTOEXPRESSION, ab, pos);
 		}
-		else if (actionname == "geturl")
+		break;
+		ACTION_NAME_CASE("geturl")
 		{
 			const char *str1 = entryt->Attribute("str1");
 			const char *str2 = entryt->Attribute("str2");
 			AddURLAction(ACTION_GETURL, ab, str1, str2);
 		}
-		else if (actionname == "constantpool")
+		break;
+		ACTION_NAME_CASE("constantpool")
 		{
 			tinyxml2::XMLElement* entryt2;
 			for (entryt2 = entryt->FirstChildElement(); entryt2 != 0; entryt2 = entryt2->NextSiblingElement())
 			{
 				ab->constantcount++;
-				AptConstItem* aci = new AptConstItem();
-				if (entryt2->Attribute("string"))
-				{
-					aci->type = TYPE_STRING;
-					aci->strvalue = entryt2->Attribute("string");
-				}
-				else
-				{
-					aci->type = TYPE_NUMBER;
-					aci->numvalue = entryt2->IntAttribute("integer");
-				}
-
-				data->items.push_back(aci);
-				ab->constants.push_back(data->itemcount++);
+				ab->constants.push_back(AddConstItem(entryt2, data));
 			}
 			AddConstantPoolAction(ACTION_CONSTANTPOOL, ab, ab->constantcount);
 		}
-		else if (actionname == "pushdata")
+		break;
+		ACTION_NAME_CASE("pushdata")
 		{
 			ab->pushdatacount++;
 			ActionPushData *pd = new ActionPushData;
@@ -1119,24 +870,12 @@ void ActionHelper::XML_ProcessActions(tinyxml2::XMLElement* entry, ActionBytes *
 			for (entryt2 = entryt->FirstChildElement(); entryt2 != 0; entryt2 = entryt2->NextSiblingElement())
 			{
 				pd->pushdatacount++;
-				AptConstItem* aci = new AptConstItem();
-				if (entryt2->Attribute("string"))
-				{
-					aci->type = TYPE_STRING;
-					aci->strvalue = entryt2->Attribute("string");
-				}
-				else
-				{
-					aci->type = TYPE_NUMBER;
-					aci->numvalue = entryt2->IntAttribute("integer");
-				}
-
-				data->items.push_back(aci);
-				pd->pushdata.push_back(data->itemcount++);
+				pd->pushdata.push_back(AddConstItem(entryt2, data));
 			}
 			AddPushDataAction(ACTION_PUSHDATA, ab, pd);
 		}
-		else if (actionname == "definefunction2")
+		break;
+		ACTION_NAME_CASE("definefunction2")
 		{
 			ab->definefunction2count++;
 			ActionDefineFunction2 *pd = new ActionDefineFunction2;
@@ -1165,7 +904,8 @@ void ActionHelper::XML_ProcessActions(tinyxml2::XMLElement* entry, ActionBytes *
             }          			        
          
 		}
-		else if (actionname == "definefunction")
+		break;
+		ACTION_NAME_CASE("definefunction")
 		{
 			ab->definefunctioncount++;
 			ActionDefineFunction *adf = new ActionDefineFunction;
@@ -1190,226 +930,279 @@ void ActionHelper::XML_ProcessActions(tinyxml2::XMLElement* entry, ActionBytes *
             }
 		
 		}
-		else if (actionname == "pushstring")
+		break;
+		ACTION_NAME_CASE("pushstring")
 		{
 			const char *str = entryt->Attribute("str");
 			AddStringAction(EA_PUSHSTRING, ab, str);
 		}
-		else if (actionname == "getstringvar")
+		break;
+		ACTION_NAME_CASE("getstringvar")
 		{
 			const char *str = entryt->Attribute("str");
 			AddStringAction(EA_GETSTRINGVAR, ab, str);
 		}
-		else if (actionname == "getstringmember")
+		break;
+		ACTION_NAME_CASE("getstringmember")
 		{
 			const char *str = entryt->Attribute("str");
 			AddStringAction(EA_GETSTRINGMEMBER, ab, str);
 		}
-		else if (actionname == "setstringvar")
+		break;
+		ACTION_NAME_CASE("setstringvar")
 		{
 			const char *str = entryt->Attribute("str");
 			AddStringAction(EA_SETSTRINGVAR, ab, str);
 		}
-		else if (actionname == "setstringmember")
+		break;
+		ACTION_NAME_CASE("setstringmember")
 		{
 			const char *str = entryt->Attribute("str");
 			AddStringAction(EA_SETSTRINGMEMBER, ab, str);
 		}
-		else if (actionname == "settarget")
+		break;
+		ACTION_NAME_CASE("settarget")
 		{
 			const char *str = entryt->Attribute("str");
 			AddStringAction(ACTION_SETTARGET, ab, str);
 		}
-		else if (actionname == "gotolabel")
+		break;
+		ACTION_NAME_CASE("gotolabel")
 		{
 			const char *str = entryt->Attribute("label");
 			AddStringAction(ACTION_GOTOLABEL, ab, str);
 		}
-		else if (actionname == "callnamedfuncpop")
+		break;
+		ACTION_NAME_CASE("callnamedfuncpop")
 		{
 			unsigned int val = entryt->IntAttribute("val");
 			AddByteAction(EA_CALLNAMEDFUNCTIONPOP, ab, (unsigned char)val);
 		}
-		else if (actionname == "callnamedfunc")
+		break;
+		ACTION_NAME_CASE("callnamedfunc")
 		{
 			unsigned int val = entryt->IntAttribute("val");
 			AddByteAction(EA_CALLNAMEDFUNCTION, ab, (unsigned char)val);
 		}
-		else if (actionname == "callnamedmethodpop")
+		break;
+		ACTION_NAME_CASE("callnamedmethodpop")
 		{
 			unsigned int val = entryt->IntAttribute("val");
 			AddByteAction(EA_CALLNAMEDMETHODPOP, ab, (unsigned char)val);
 		}
-		else if (actionname == "callnamedmethod")
+		break;
+		ACTION_NAME_CASE("callnamedmethod")
 		{
 			unsigned int val = entryt->IntAttribute("val");
 			AddByteAction(EA_CALLNAMEDMETHOD, ab, (unsigned char)val);
 		}
-		else if (actionname == "pushconstant")
+		break;
+		ACTION_NAME_CASE("pushconstant")
 		{
 			unsigned int val = entryt->IntAttribute("val");
 			AddByteAction(EA_PUSHCONSTANT, ab, (unsigned char)val);
 		}
-		else if (actionname == "pushvalue")
+		break;
+		ACTION_NAME_CASE("pushvalue")
 		{
 			unsigned int val = entryt->IntAttribute("val");
 			AddByteAction(EA_PUSHVALUEOFVAR, ab, (unsigned char)val);
 		}
-		else if (actionname == "pushbyte")
+		break;
+		ACTION_NAME_CASE("pushbyte")
 		{
 			unsigned int val = entryt->IntAttribute("val");
 			AddByteAction(EA_PUSHBYTE, ab, (unsigned char)val);
 		}
-		else if (actionname == "getnamedmember")
+		break;
+		ACTION_NAME_CASE("getnamedmember")
 		{
 			unsigned int val = entryt->IntAttribute("val");
 			AddByteAction(EA_GETNAMEDMEMBER, ab, (unsigned char)val);
 		}
-		else if (actionname == "pushregister")
+		break;
+		ACTION_NAME_CASE("pushregister")
 		{
 			unsigned int val = entryt->IntAttribute("val");
 			AddByteAction(EA_PUSHREGISTER, ab, (unsigned char)val);
 		}
-		else if (actionname == "pushshort")
+		break;
+		ACTION_NAME_CASE("pushshort")
 		{
 			unsigned int val = entryt->IntAttribute("val");;
 			AddShortAction(EA_PUSHSHORT, ab, (unsigned short)val);
 		}
-		else if (actionname == "pushwordconstant")
+		break;
+		ACTION_NAME_CASE("pushwordconstant")
 		{
 			unsigned int val = entryt->IntAttribute("val");;
 			AddShortAction(EA_PUSHWORDCONSTANT, ab, (unsigned short)val);
 		}
-		else if (actionname == "pushfloat")
+		break;
+		ACTION_NAME_CASE("pushfloat")
 		{
 			float val = entryt->FloatAttribute("val");
 			AddFloatAction(EA_PUSHFLOAT, ab, val);
 		}
-		else if (actionname == "pushlong")
+		break;
+		ACTION_NAME_CASE("pushlong")
 		{
 			unsigned int val = entryt->IntAttribute("val");
 			AddLongAction(EA_PUSHLONG, ab, val);
 		}
-		else if (actionname == "logicaland")
+		break;
+		ACTION_NAME_CASE("logicaland")
 		{
 			AddAction(ACTION_LOGICALAND, ab);
 		}
-		else if (actionname == "logicalor")
+		break;
+		ACTION_NAME_CASE("logicalor")
 		{
 			AddAction(ACTION_LOGICALOR, ab);
 		}
-		else if (actionname == "logicalnot")
+		break;
+		ACTION_NAME_CASE("logicalnot")
 		{
 			AddAction(ACTION_LOGICALNOT, ab);
 		}
-		else if (actionname == "pushone")
+		break;
+		ACTION_NAME_CASE("pushone")
 		{
 			AddAction(EA_PUSHONE, ab);
 		}
-		else if (actionname == "trace")
+		break;
+		ACTION_NAME_CASE("trace")
 		{
 			AddAction(ACTION_TRACE,ab);
 		}
-		else if (actionname == "new")
+		break;
+		ACTION_NAME_CASE("new")
 		{
 			AddAction(ACTION_NEW, ab);
 		}
-		else if (actionname == "setmember")
+		break;
+		ACTION_NAME_CASE("setmember")
 		{
 			AddAction(ACTION_SETMEMBER, ab);
 		}
-		else if (actionname == "pushzero")
+		break;
+		ACTION_NAME_CASE("pushzero")
 		{
 			AddAction(EA_PUSHZERO, ab);
 		}
-		else if (actionname == "pop")
+		break;
+		ACTION_NAME_CASE("pop")
 		{
 			AddAction(ACTION_POP, ab);
 		}
-		else if (actionname == "getmember")
+		break;
+		ACTION_NAME_CASE("getmember")
 		{
 			AddAction(ACTION_GETMEMBER, ab);
 		}
-		else if (actionname == "dup")
+		break;
+		ACTION_NAME_CASE("dup")
 		{
 			AddAction(ACTION_DUP, ab);
 		}
-		else if (actionname == "newadd")
+		break;
+		ACTION_NAME_CASE("newadd")
 		{
 			AddAction(ACTION_NEWADD, ab);
 		}
-		else if (actionname == "newlessthan")
+		break;
+		ACTION_NAME_CASE("newlessthan")
 		{
 			AddAction(ACTION_NEWLESSTHAN, ab);
 		}
-		else if (actionname == "newequals")
+		break;
+		ACTION_NAME_CASE("newequals")
 		{
 			AddAction(ACTION_NEWEQUALS, ab);
 		}
-		else if (actionname == "pushtrue")
+		break;
+		ACTION_NAME_CASE("pushtrue")
 		{
 			AddAction(EA_PUSHTRUE, ab);
 		}
-		else if (actionname == "pushfalse")
+		break;
+		ACTION_NAME_CASE("pushfalse")
 		{
 			AddAction(EA_PUSHFALSE, ab);
 		}
-		else if (actionname == "pushnull")
+		break;
+		ACTION_NAME_CASE("pushnull")
 		{
 			AddAction(EA_PUSHNULL, ab);
 		}
-		else if (actionname == "pushundefined")
+		break;
+		ACTION_NAME_CASE("pushundefined")
 		{
 			AddAction(EA_PUSHUNDEFINED, ab);
 		}
-		else if (actionname == "increment")
+		break;
+		ACTION_NAME_CASE("increment")
 		{
 			AddAction(ACTION_INCREMENT, ab);
 		}
-		else if (actionname == "decrement")
+		break;
+		ACTION_NAME_CASE("decrement")
 		{
 			AddAction(ACTION_DECREMENT, ab);
 		}
-		else if (actionname == "definelocal")
+		break;
+		ACTION_NAME_CASE("definelocal")
 		{
 			AddAction(ACTION_DEFINELOCAL, ab);
 		}
-		else if (actionname == "greater")
+		break;
+		ACTION_NAME_CASE("greater")
 		{
 			AddAction(ACTION_GREATER, ab);
 		}
-		else if (actionname == "pushthis")
+		break;
+		ACTION_NAME_CASE("pushthis")
 		{
 			AddAction(EA_PUSHTHIS, ab);
 		}
-		else if (actionname == "pushglobal")
+		break;
+		ACTION_NAME_CASE("pushglobal")
 		{
 			AddAction(EA_PUSHGLOBAL, ab);
 		}
-		else if (actionname == "getvariable")
+		break;
+		ACTION_NAME_CASE("getvariable")
 		{
 			AddAction(ACTION_GETVARIABLE, ab);
 		}
-		else if (actionname == "setvariable")
+		break;
+		ACTION_NAME_CASE("setvariable")
 		{
 			AddAction(ACTION_SETVARIABLE, ab);
 		}
-        else if (actionname == "geturl2")
-        {
+		break;
+		ACTION_NAME_CASE("geturl2")
+		{
             AddAction(ACTION_GETURL2, ab);
-        }
-        else if (actionname == "end")
-        {
+		}
+		break;
+		ACTION_NAME_CASE("end")
+		{
             AddAction(ACTION_END, ab);
-        }
-		else if (actionname == "noarg")
+		}
+		break;
+		ACTION_NAME_CASE("noarg")
 		{
 			unsigned int action = entryt->IntAttribute("action");
 			AddAction((action_type)action, ab);
-		}	
-		else
-		{
+		}
+		break;
+		default:
+		unknown:
 			std::cout << "Unknown action: " << actionname << std::endl;
+			break;
 		}
 	}
 }
+
+#undef ACTION_NAME_CASE
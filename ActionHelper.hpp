@@ -1,4 +1,5 @@
 #include "Util.hpp"
+#include "ByteBuffer.hpp"
 #include "tinyxml2.h"
 #include "Constfile.hpp"
 #include <sstream>
@@ -224,7 +225,7 @@ public:
 
 	struct ActionBytes {
 		uint32_t actionbytecount;
-		std::stringstream actionbytes;
+		ByteBuffer actionbytes;
 		uint32_t constantcount;
 		std::vector<uint32_t> constants;
 		uint32_t stringcount;
@@ -239,6 +240,7 @@ public:
 
 	static void APT_ProcessActions(tinyxml2::XMLDocument& doc,tinyxml2::XMLElement* parent, uint8_t *actions, uint8_t *aptaptdata, AptConstData* data, uint8_t* aptbuffer);
 	static void XML_ProcessActions(tinyxml2::XMLElement* entry, ActionHelper::ActionBytes *ab, AptConstData* data);
+	static uint32_t AddConstItem(tinyxml2::XMLElement* entry, AptConstData* data);
 	static void AddAction(action_type action, ActionBytes* ab);
 	static void AddIntAction(action_type action, ActionBytes *ab, int actionvalue);
 	static void AddStringAction(action_type action, ActionBytes *ab, const char *actionstring);
@@ -0,0 +1,704 @@
+#include <algorithm>
+#include <ciso646>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ActionFlowGraph.hpp"
+#include "AptConstFile.hpp"
+#include "AptEditor.hpp"
+#include "AptToXmlHints.hpp"
+#include "Util.hpp"
+#include "tinyxml2.h"
+
+// Peephole optimization of the action streams of an .xml document, before
+// xmlToApt lays them out. Instructions are kept as the elements aptToXml wrote,
+// branch destinations and function ends as indices into the stream, so any
+// instruction can be replaced or removed; addresses are only written back at the
+// end, for the instructions something still points to.
+//
+// Constant IDs of PushData and of the EA byte forms all index the items of the
+// .const file, the same way AptToXmlHints reads them; internStrings moves inline
+// strings there.
+namespace Apt::AptEditor {
+
+using namespace AptTypes;
+using ActionFlow::isBranch;
+using ActionFlow::isFunctionDefinition;
+using AptToXmlHints::setNumberAttribute;
+
+namespace {
+
+using Element = tinyxml2::XMLElement;
+
+constexpr auto none = (std::numeric_limits<std::size_t>::max)();
+
+// one instruction of the stream; target is the branch destination, or the last
+// instruction of the body of a DefineFunction (the DefineFunction itself if empty)
+struct Action {
+    Element* element;
+    std::string type;
+    std::size_t target = none;
+    bool removed = false;
+};
+
+std::vector<Element*> getInstructionElements(Element& stream) {
+    auto elements = std::vector<Element*>{};
+    for (auto* child = stream.FirstChildElement(); child != nullptr;
+         child = child->NextSiblingElement()) {
+        elements.emplace_back(child);
+    }
+    const auto byArrayIndex = [](const Element* a, const Element* b) {
+        return a->IntAttribute("arrayIndex") < b->IntAttribute("arrayIndex");
+    };
+    std::stable_sort(elements.begin(), elements.end(), byArrayIndex);
+    return elements;
+}
+
+std::vector<Action> readActions(Element& stream) {
+    auto actions = std::vector<Action>{};
+    auto indices = std::map<Address, std::size_t>{};
+    for (auto* element : getInstructionElements(stream)) {
+        const auto* type = element->Attribute("type");
+        if (element->Attribute("address") != nullptr) {
+            indices.emplace(element->UnsignedAttribute("address"), actions.size());
+        }
+        actions.push_back(Action{ element, type == nullptr ? "" : type });
+    }
+
+    const auto indexOf = [&indices](const Element& element, const char* attribute) {
+        const auto destination = element.UnsignedAttribute(attribute);
+        const auto found = indices.find(destination);
+        if (found == indices.end()) {
+            throw std::runtime_error{ asString(
+                "Unknown branch destination ", destination, " of ", element.Attribute("type"),
+                " (xml exported without instruction address?)") };
+        }
+        return found->second;
+    };
+    for (auto& action : actions) {
+        if (isBranch(action.type)) {
+            action.target = indexOf(*action.element, "destinationAddress");
+        }
+        else if (isFunctionDefinition(action.type)) {
+            action.target = indexOf(*action.element, "lastInstructionStartAddress");
+        }
+    }
+    return actions;
+}
+
+// what the Unreachable hints of aptToXml mark, see ActionFlow::buildFlowGraph
+void removeUnreachable(std::vector<Action>& actions) {
+    const auto typeOf = [&actions](const std::size_t i) -> const std::string& {
+        return actions[i].type;
+    };
+    // the flow graph counts a function body up to the instruction past it
+    const auto targetOf = [&actions](const std::size_t i) {
+        const auto& action = actions[i];
+        return isFunctionDefinition(action.type) ? action.target + 1 : action.target;
+    };
+    const auto reachable =
+        ActionFlow::findReachableInstructions(actions.size(), typeOf, targetOf);
+    for (auto i = std::size_t{ 0 }; i < actions.size(); ++i) {
+        actions[i].removed = not reachable[i];
+    }
+}
+
+// drops removed actions: a branch to one of them goes on to the next instruction
+// left, a function body ends at the last instruction left in it
+std::vector<Action> compact(const std::vector<Action>& actions) {
+    auto newIndices = std::vector<std::size_t>(actions.size(), none);
+    auto next = none;
+    for (auto i = actions.size(); i-- > 0;) {
+        if (not actions[i].removed) {
+            next = i;
+        }
+        newIndices[i] = next;
+    }
+    auto previousKept = std::vector<std::size_t>(actions.size(), none);
+    auto previous = none;
+    for (auto i = std::size_t{ 0 }; i < actions.size(); ++i) {
+        if (not actions[i].removed) {
+            previous = i;
+        }
+        previousKept[i] = previous;
+    }
+
+    auto result = std::vector<Action>{};
+    auto renumbered = std::vector<std::size_t>(actions.size(), none);
+    for (auto i = std::size_t{ 0 }; i < actions.size(); ++i) {
+        if (not actions[i].removed) {
+            renumbered[i] = result.size();
+            result.emplace_back(actions[i]);
+        }
+    }
+    for (auto i = std::size_t{ 0 }; i < actions.size(); ++i) {
+        if (actions[i].removed or actions[i].target == none) {
+            continue;
+        }
+        auto& action = result[renumbered[i]];
+        if (isFunctionDefinition(action.type)) {
+            // the body cannot shrink past its own DefineFunction
+            action.target = renumbered[(std::max)(previousKept[action.target], i)];
+            continue;
+        }
+        const auto destination = newIndices[action.target];
+        if (destination == none) {
+            throw std::logic_error{ "Branch to a removed instruction at the end of the stream" };
+        }
+        action.target = renumbered[destination];
+    }
+    return result;
+}
+
+class Peephole {
+public:
+    Peephole(tinyxml2::XMLDocument& document,
+             Element& stream,
+             const ConstFile::ConstData& constData) :
+        document{ document }, stream{ stream }, constData{ constData } {}
+
+    std::vector<Action> run(std::vector<Action> actions) {
+        this->isTarget.assign(actions.size(), false);
+        this->isBodyEnd.assign(actions.size(), false);
+        for (const auto& action : actions) {
+            if (action.target == none) {
+                continue;
+            }
+            auto& marks = isFunctionDefinition(action.type) ? this->isBodyEnd : this->isTarget;
+            marks[action.target] = true;
+        }
+        // a pattern may start at a destination, but nothing else may lead into it,
+        // and it may not reach past the end of a function body
+        const auto matches = [&](const std::size_t first,
+                                 std::initializer_list<std::string_view> types) {
+            auto i = first;
+            for (const auto type : types) {
+                const auto isLast = i + 1 - first == types.size();
+                if (i >= actions.size() or actions[i].type != type or
+                    (i != first and this->isTarget[i]) or (not isLast and this->isBodyEnd[i])) {
+                    return false;
+                }
+                ++i;
+            }
+            return true;
+        };
+
+        auto result = std::vector<Action>{};
+        // branches lead to the first instruction written for a pattern,
+        // a function body ends with the last one
+        auto firstWritten = std::vector<std::size_t>(actions.size(), none);
+        auto lastWritten = std::vector<std::size_t>(actions.size(), none);
+        auto i = std::size_t{ 0 };
+        while (i < actions.size()) {
+            firstWritten[i] = result.size();
+            this->anchor = actions[i].element;
+            auto replaced = std::size_t{ 0 };
+
+            if (matches(i, { "PushData" })) {
+                replaced = this->rewritePushData(actions, i, matches, result);
+            }
+            else if (matches(i, { "EA_PushString", "GetVariable" })) {
+                result.emplace_back(this->fromPushString(*actions[i].element, "EA_GetStringVar",
+                                                         "variableName"));
+                replaced = 2;
+            }
+            else if (matches(i, { "EA_PushString", "GetMember" })) {
+                result.emplace_back(this->fromPushString(*actions[i].element,
+                                                         "EA_GetStringMember",
+                                                         "memberVariableName"));
+                replaced = 2;
+            }
+            else if (matches(i, { "CallMethod", "Pop" })) {
+                result.emplace_back(this->newAction("EA_CallMethodPop"));
+                replaced = 2;
+            }
+
+            if (replaced == 0) {
+                result.emplace_back(actions[i]);
+                replaced = 1;
+            }
+            else {
+                for (auto j = i; j < i + replaced; ++j) {
+                    this->replacedElements.emplace_back(actions[j].element);
+                }
+            }
+            i += replaced;
+            lastWritten[i - 1] = result.size() - 1;
+        }
+        for (auto& action : result) {
+            if (action.target != none) {
+                action.target = isFunctionDefinition(action.type) ? lastWritten[action.target]
+                                                                  : firstWritten[action.target];
+            }
+        }
+        return result;
+    }
+
+    // elements of the instructions which have been rewritten into others
+    std::vector<Element*> replacedElements;
+
+private:
+    template <typename Matches>
+    std::size_t rewritePushData(const std::vector<Action>& actions,
+                                const std::size_t index,
+                                const Matches& matches,
+                                std::vector<Action>& result) {
+        const auto ids = this->constantIDs(*actions[index].element);
+        if (not ids.has_value() or ids->empty()) {
+            return 0;
+        }
+        auto pushes = std::vector<Action>{};
+        for (const auto id : ids.value()) {
+            auto push = this->shortPush(id);
+            if (not push.has_value()) {
+                for (const auto& unused : pushes) {
+                    this->deleteElement(unused.element);
+                }
+                return 0;
+            }
+            pushes.emplace_back(std::move(push.value()));
+        }
+
+        // the last value may be consumed right away by the next instruction
+        auto replaced = std::size_t{ 1 };
+        const auto last = ids->back();
+        const auto isName = last <= 0xFF and last < this->constData.itemCount() and
+                            this->constData.itemTypes[last] == ConstFile::ConstItemType::string;
+        const auto consumeLast = [&](const char* type, const char* member) {
+            this->deleteElement(pushes.back().element);
+            pushes.back() = this->newAction(type);
+            pushes.back().element->SetAttribute(member, last);
+        };
+        // a value popped right away is not pushed at all, unless nothing would be
+        // left at the end of the stream, or a branch to this PushData would lead
+        // past the function body the Pop ends
+        const auto leavesInstruction =
+            pushes.size() > 1 or (index + 2 < actions.size() and
+                                  not (this->isTarget[index] and this->isBodyEnd[index + 1]));
+        if (matches(index, { "PushData", "Pop" }) and leavesInstruction) {
+            this->deleteElement(pushes.back().element);
+            pushes.pop_back();
+            replaced = 2;
+        }
+        else if (isName and matches(index, { "PushData", "GetVariable" })) {
+            consumeLast("EA_PushValueOfVar", "variableNameConstantID");
+            replaced = 2;
+        }
+        else if (isName and matches(index, { "PushData", "GetMember" })) {
+            consumeLast("EA_GetNamedMember", "memberNameConstantID");
+            replaced = 2;
+        }
+        else if (isName and matches(index, { "PushData", "CallMethod", "Pop" })) {
+            consumeLast("EA_CallNamedMethodPop", "functionNameConstantID");
+            replaced = 3;
+        }
+        result.insert(result.end(), pushes.begin(), pushes.end());
+        return replaced;
+    }
+
+    // nothing if the ids are not written out, e.g. in a partial or shared array
+    std::optional<std::vector<std::uint32_t>> constantIDs(const Element& pushData) const {
+        for (const auto* child = pushData.FirstChildElement(); child != nullptr;
+             child = child->NextSiblingElement()) {
+            const auto* name = child->Attribute("name");
+            if (name == nullptr or std::string_view{ name } != "constantIDArray") {
+                continue;
+            }
+            if (std::string_view{ child->Name() } != "Array") {
+                return std::nullopt;
+            }
+            auto elements = std::vector<const Element*>{};
+            for (const auto* id = child->FirstChildElement(); id != nullptr;
+                 id = id->NextSiblingElement()) {
+                elements.emplace_back(id);
+            }
+            std::stable_sort(elements.begin(), elements.end(), [](const auto* a, const auto* b) {
+                return a->IntAttribute("arrayIndex") < b->IntAttribute("arrayIndex");
+            });
+            auto ids = std::vector<std::uint32_t>{};
+            for (const auto* id : elements) {
+                ids.emplace_back(id->UnsignedAttribute("value"));
+            }
+            return ids;
+        }
+        return std::nullopt;
+    }
+
+    // the shortest instruction pushing const item id, or nothing if PushData has to
+    // stay: EA_PushConstantByte and EA_PushConstantWord only push strings, and a
+    // lookup item only means something inside PushData
+    std::optional<Action> shortPush(const std::uint32_t id) {
+        if (id >= this->constData.itemCount()) {
+            return std::nullopt;
+        }
+        const auto item = this->constData.itemAt(id);
+        switch (item.type) {
+        case ConstFile::ConstItemType::string: {
+            if (id > 0xFFFF) {
+                return std::nullopt;
+            }
+            auto push = this->newAction(id <= 0xFF ? "EA_PushConstantByte"
+                                                   : "EA_PushConstantWord");
+            push.element->SetAttribute("constantID", id);
+            return push;
+        }
+        case ConstFile::ConstItemType::boolean:
+            return this->newAction(item.get<bool>() ? "EA_PushTrue" : "EA_PushFalse");
+        case ConstFile::ConstItemType::integer: {
+            const auto value = item.get<std::int32_t>();
+            if (value == 0 or value == 1) {
+                return this->newAction(value == 0 ? "EA_PushZero" : "EA_PushOne");
+            }
+            if (value < 0 or value > 0xFFFF) {
+                return std::nullopt;
+            }
+            auto push = this->newAction(value <= 0xFF ? "EA_PushByte" : "EA_PushShort");
+            push.element->SetAttribute("value", value);
+            return push;
+        }
+        case ConstFile::ConstItemType::single: {
+            auto push = this->newAction("EA_PushFloat");
+            setNumberAttribute(push.element, "value", item.get<float>());
+            return push;
+        }
+        case ConstFile::ConstItemType::aptRegister: {
+            const auto registerNumber = item.get<std::uint32_t>();
+            if (registerNumber > 0xFF) {
+                return std::nullopt;
+            }
+            auto push = this->newAction("EA_PushRegister");
+            push.element->SetAttribute("register", registerNumber);
+            return push;
+        }
+        default:
+            return std::nullopt;
+        }
+    }
+
+    // EA_PushString followed by what it is the name for becomes one instruction
+    // with the same string, which is moved over from the EA_PushString
+    Action fromPushString(Element& pushString, const char* type, const char* member) {
+        auto action = this->newAction(type);
+        for (auto* child = pushString.FirstChildElement(); child != nullptr;
+             child = child->NextSiblingElement()) {
+            if (const auto* name = child->Attribute("name");
+                name != nullptr and std::string_view{ name } == "value") {
+                child->SetAttribute("name", member);
+                action.element->InsertEndChild(child);
+                break;
+            }
+        }
+        return action;
+    }
+
+    // inserted right after the previous new instruction, in place of the old ones
+    Action newAction(const char* type) {
+        auto* element = this->document.NewElement("Instruction");
+        element->SetAttribute("type", type);
+        this->stream.InsertAfterChild(this->anchor, element);
+        this->anchor = element;
+        return Action{ element, type };
+    }
+
+    void deleteElement(Element* element) {
+        if (this->anchor == element) {
+            this->anchor = element->PreviousSibling();
+        }
+        this->stream.DeleteChild(element);
+    }
+
+    tinyxml2::XMLDocument& document;
+    Element& stream;
+    const ConstFile::ConstData& constData;
+    tinyxml2::XMLNode* anchor = nullptr;
+    // of the actions given to run
+    std::vector<bool> isTarget;
+    std::vector<bool> isBodyEnd;
+};
+
+// a branch to a BranchAlways goes straight to where that one leads
+void threadJumps(std::vector<Action>& actions) {
+    for (auto& action : actions) {
+        if (not isBranch(action.type)) {
+            continue;
+        }
+        // an endless loop of branches is left as it is
+        for (auto hops = std::size_t{ 0 };
+             hops < actions.size() and actions[action.target].type == "BranchAlways"; ++hops) {
+            action.target = actions[action.target].target;
+        }
+    }
+}
+
+// backwards, so that a branch over branches which have been removed is found too
+void removeBranchesToNext(tinyxml2::XMLDocument& document,
+                          Element& stream,
+                          std::vector<Action>& actions) {
+    auto isBodyEnd = std::vector<bool>(actions.size(), false);
+    for (const auto& action : actions) {
+        if (isFunctionDefinition(action.type)) {
+            isBodyEnd[action.target] = true;
+        }
+    }
+
+    auto next = actions.size();
+    for (auto i = actions.size(); i-- > 0;) {
+        auto& action = actions[i];
+        // falling off the end of a function body returns instead
+        if (isBranch(action.type) and not isBodyEnd[i]) {
+            auto destination = action.target;
+            while (destination < actions.size() and actions[destination].removed) {
+                ++destination;
+            }
+            if (destination == next) {
+                if (action.type == "BranchAlways") {
+                    action.removed = true;
+                    continue;
+                }
+                // the condition still has to be popped
+                auto* pop = document.NewElement("Instruction");
+                pop->SetAttribute("type", "Pop");
+                stream.InsertAfterChild(action.element, pop);
+                stream.DeleteChild(action.element);
+                action = Action{ pop, "Pop" };
+            }
+        }
+        next = i;
+    }
+}
+
+// writes arrayIndex, and address / destinationAddress / lastInstructionStartAddress
+// from the targets
+void writeActions(const std::vector<Action>& actions) {
+    auto nextAddress = Address{ 0 };
+    for (const auto& action : actions) {
+        if (action.element->Attribute("address") != nullptr) {
+            nextAddress = (std::max)(nextAddress, action.element->UnsignedAttribute("address") + 1);
+        }
+    }
+    auto isTarget = std::vector<bool>(actions.size(), false);
+    for (const auto& action : actions) {
+        if (action.target != none) {
+            isTarget[action.target] = true;
+        }
+    }
+    for (auto i = std::size_t{ 0 }; i < actions.size(); ++i) {
+        auto& element = *actions[i].element;
+        element.SetAttribute("arrayIndex", static_cast<unsigned>(i));
+        if (isTarget[i] and element.Attribute("address") == nullptr) {
+            element.SetAttribute("address", nextAddress++);
+        }
+    }
+    for (const auto& action : actions) {
+        if (action.target == none) {
+            continue;
+        }
+        const auto destination = actions[action.target].element->UnsignedAttribute("address");
+        action.element->SetAttribute(isBranch(action.type) ? "destinationAddress"
+                                                            : "lastInstructionStartAddress",
+                                     destination);
+    }
+}
+
+void deleteInstruction(Element& stream, Element* element) {
+    // the hint aptToXml wrote for an unreachable run goes with it
+    if (auto* previous = element->PreviousSibling(); previous != nullptr and
+        previous->ToComment() != nullptr and
+        std::string_view{ previous->Value() } == "Unreachable") {
+        stream.DeleteChild(previous);
+    }
+    stream.DeleteChild(element);
+}
+
+void optimizeStream(tinyxml2::XMLDocument& document,
+                    Element& stream,
+                    const ConstFile::ConstData& constData,
+                    ActionOptimization& statistics) {
+    auto actions = readActions(stream);
+    statistics.instructionsBefore += actions.size();
+
+    removeUnreachable(actions);
+    auto removed = std::vector<Element*>{};
+    for (const auto& action : actions) {
+        if (action.removed) {
+            removed.emplace_back(action.element);
+        }
+    }
+    actions = compact(actions);
+
+    auto peephole = Peephole{ document, stream, constData };
+    actions = peephole.run(std::move(actions));
+    removed.insert(removed.end(), peephole.replacedElements.begin(),
+                   peephole.replacedElements.end());
+
+    threadJumps(actions);
+    removeBranchesToNext(document, stream, actions);
+    for (const auto& action : actions) {
+        if (action.removed) {
+            removed.emplace_back(action.element);
+        }
+    }
+    actions = compact(actions);
+
+    for (auto* element : removed) {
+        deleteInstruction(stream, element);
+    }
+    writeActions(actions);
+    statistics.instructionsAfter += actions.size();
+    statistics.streams += 1;
+}
+
+void findStreams(Element& element, std::vector<Element*>& streams) {
+    for (auto* child = element.FirstChildElement(); child != nullptr;
+         child = child->NextSiblingElement()) {
+        const auto* name = child->Attribute("name");
+        if (name != nullptr and std::string_view{ name } == "actionDataOffset" and
+            std::string_view{ child->Name() } == "Array") {
+            streams.emplace_back(child);
+            continue;
+        }
+        findStreams(*child, streams);
+    }
+}
+
+// an inline string instruction and the constant indexed one it can become
+struct StringForm {
+    std::string_view type;
+    std::string_view stringMember;
+    const char* constantType;
+    const char* constantIDMember;
+    std::size_t maxConstantID;
+};
+
+constexpr StringForm stringForms[] = {
+    { "EA_PushString", "value", "EA_PushConstantByte", "constantID", 0xFF },
+    { "EA_PushString", "value", "EA_PushConstantWord", "constantID", 0xFFFF },
+    { "EA_GetStringVar", "variableName", "EA_PushValueOfVar", "variableNameConstantID", 0xFF },
+    { "EA_GetStringMember", "memberVariableName", "EA_GetNamedMember", "memberNameConstantID",
+      0xFF },
+};
+
+// the string of an inline string instruction, if it is written out
+Element* findStringElement(Element& instruction, const std::string_view member) {
+    for (auto* child = instruction.FirstChildElement(); child != nullptr;
+         child = child->NextSiblingElement()) {
+        const auto* name = child->Attribute("name");
+        if (name != nullptr and member == name) {
+            const auto isString = std::string_view{ child->Name() } == "String" and
+                                  child->Attribute("value") != nullptr;
+            return isString ? child : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+ActionOptimization optimizeActions(tinyxml2::XMLElement& aptDataNode,
+                                   const ConstFile::ConstData& constData) {
+    auto streams = std::vector<Element*>{};
+    findStreams(aptDataNode, streams);
+    auto statistics = ActionOptimization{};
+    for (auto* stream : streams) {
+        optimizeStream(*aptDataNode.GetDocument(), *stream, constData, statistics);
+    }
+    return statistics;
+}
+
+StringInterning internStrings(tinyxml2::XMLElement& aptDataNode,
+                              ConstFile::ConstData& constData) {
+    struct Use {
+        Element* instruction;
+        Element* string;
+        std::size_t maxConstantID; // of the widest form
+    };
+    auto uses = std::vector<Use>{};
+    auto streams = std::vector<Element*>{};
+    findStreams(aptDataNode, streams);
+    for (auto* stream : streams) {
+        for (auto* instruction : getInstructionElements(*stream)) {
+            const auto* type = instruction->Attribute("type");
+            auto use = Use{ instruction, nullptr, 0 };
+            for (const auto& form : stringForms) {
+                if (type == nullptr or form.type != type) {
+                    continue;
+                }
+                use.string = findStringElement(*instruction, form.stringMember);
+                use.maxConstantID = (std::max)(use.maxConstantID, form.maxConstantID);
+            }
+            if (use.string != nullptr) {
+                uses.emplace_back(use);
+            }
+        }
+    }
+
+    // the first item of each string is used, as an older item has the smaller index
+    auto constantIDs = std::map<std::string, std::size_t, std::less<>>{};
+    for (auto i = std::size_t{ 0 }; i < constData.itemCount(); ++i) {
+        if (constData.itemTypes[i] == ConstFile::ConstItemType::string) {
+            constantIDs.try_emplace(std::string{ constData.stringAt(i) }, i);
+        }
+    }
+
+    // new strings used most often get the indices the byte forms can still reach
+    struct NewString {
+        std::string_view value;
+        std::size_t count;
+        std::size_t maxConstantID;
+    };
+    auto newStrings = std::vector<NewString>{};
+    auto newStringIndices = std::map<std::string_view, std::size_t>{};
+    for (const auto& use : uses) {
+        const auto value = std::string_view{ use.string->Attribute("value") };
+        if (constantIDs.count(value) != 0) {
+            continue;
+        }
+        const auto [found, inserted] = newStringIndices.try_emplace(value, newStrings.size());
+        if (inserted) {
+            newStrings.push_back(NewString{ value, 0, 0 });
+        }
+        auto& newString = newStrings[found->second];
+        newString.count += 1;
+        newString.maxConstantID = (std::max)(newString.maxConstantID, use.maxConstantID);
+    }
+    std::stable_sort(newStrings.begin(), newStrings.end(),
+                     [](const NewString& a, const NewString& b) { return a.count > b.count; });
+
+    auto result = StringInterning{};
+    for (const auto& newString : newStrings) {
+        // an index no instruction using the string can hold is not worth adding
+        if (constData.itemCount() <= newString.maxConstantID) {
+            constantIDs.emplace(newString.value, constData.appendString(newString.value));
+            result.addedStrings += 1;
+        }
+    }
+
+    for (const auto& [instruction, string, maxConstantID] : uses) {
+        const auto found = constantIDs.find(std::string_view{ string->Attribute("value") });
+        if (found == constantIDs.end()) {
+            continue;
+        }
+        const auto constantID = found->second;
+        const auto type = std::string_view{ instruction->Attribute("type") };
+        for (const auto& form : stringForms) {
+            if (form.type != type or constantID > form.maxConstantID) {
+                continue;
+            }
+            instruction->DeleteChild(string);
+            instruction->SetAttribute("type", form.constantType);
+            instruction->SetAttribute(form.constantIDMember, static_cast<unsigned>(constantID));
+            result.rewrittenInstructions += 1;
+            break;
+        }
+    }
+    return result;
+}
+
+} // namespace Apt::AptEditor
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <vector>
 #include <map>
+#include <memory>
 #include <string>
 #include <string_view>
 
@@ -12,7 +13,11 @@ namespace Apt::AptParseUtilities {
             UnparsedDataView(UnparsedData* source, const std::string_view view, std::size_t viewPosition) : 
                 source{source}, view{view}, viewPosition{viewPosition}
             {
-                if(std::string_view{this->source->data}.substr(this->viewPosition, this->view.size()) != this->view) {
+                // views are always cut from source->bytes(), so checking where they point is enough
+                // and does not touch the bytes themselves
+                const auto data = this->source->bytes();
+                if(this->viewPosition > data.size() || this->view.size() > data.size() - this->viewPosition ||
+                   this->view.data() != data.data() + this->viewPosition) {
                     throw std::invalid_argument{"Invalid source / view / viewPosition!"};
                 }
             }
@@ -40,6 +45,11 @@ namespace Apt::AptParseUtilities {
                 return *this;
             }
             
+            // the bytes not read yet, without marking them as read
+            std::string_view remaining() const noexcept {
+                return this->view;
+            }
+
             UnparsedDataView subView(const std::size_t from) const {
                 return this->split(from).second;
             }
@@ -90,8 +100,20 @@ namespace Apt::AptParseUtilities {
             *this = UnparsedData{ std::forward<StringType>(data) };
         }
 
+        // reads bytes which owner keeps alive, like a mapped file, instead of data
+        void reset(const std::string_view bytes, std::shared_ptr<const void> owner) {
+            *this = UnparsedData{};
+            this->borrowed = bytes;
+            this->owner = std::move(owner);
+            unparsedBeginEnd = { { 0, bytes.size() } };
+        }
+
+        std::string_view bytes() const noexcept {
+            return this->owner == nullptr ? std::string_view{ this->data } : this->borrowed;
+        }
+
         UnparsedDataView getView() {
-            return UnparsedDataView{this, this->data, 0};
+            return UnparsedDataView{this, this->bytes(), 0};
         }
 
         void updateUnparsed(const std::size_t beginParsed, const std::size_t endParsed) {
@@ -132,7 +154,12 @@ namespace Apt::AptParseUtilities {
             }
         }
 
+        // empty when the bytes are borrowed, see bytes()
         std::string data;
         std::map<std::size_t, std::size_t> unparsedBeginEnd;
+
+    private:
+        std::string_view borrowed;
+        std::shared_ptr<const void> owner;
     };
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace Apt::AptWriteUtilities {
+    struct OutputData {
+        struct OutputDataView {
+            OutputDataView(OutputData* destination, std::size_t viewPosition) :
+                destination{destination}, viewPosition{viewPosition} {}
+
+            OutputData* getFullData() noexcept {
+                return this->destination;
+            }
+
+            void writeFront(const std::string_view bytes) {
+                auto& data = this->destination->data;
+                if(data.size() < this->viewPosition + bytes.size()) {
+                    data.resize(this->viewPosition + bytes.size());
+                }
+                std::copy(bytes.begin(), bytes.end(), data.begin() + this->viewPosition);
+                this->viewPosition += bytes.size();
+            }
+
+            template<typename T>
+            OutputDataView& writeFrontAs(const T& value) {
+                static_assert(std::is_trivially_copyable_v<T>);
+                this->writeFront(std::string_view{reinterpret_cast<const char*>(&value), sizeof(T)});
+                return *this;
+            }
+
+            void skipFront(const std::size_t length) {
+                this->writeFront(std::string(length, '\0'));
+            }
+
+            std::size_t absolutePosition() const noexcept {
+                return this->viewPosition;
+            }
+
+        private:
+            OutputData* destination;
+            std::size_t viewPosition;
+        };
+
+        OutputDataView getViewAt(const std::size_t position) {
+            return OutputDataView{this, position};
+        }
+
+        std::string data;
+    };
+}
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <ciso646>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "AptConstFile.hpp"
+#include "AptEditor.hpp"
+#include "AptTypes.hpp"
+#include "Util.hpp"
+#include "tinyxml2.h"
+
+// Times what writeXml spends on text: escaping the strings of a movie and
+// formatting its numbers, each the way it is done now and the way it was done
+// before (xmlEscape through an ostringstream, numbers through tinyxml2's
+// snprintf or an ostringstream).
+namespace Apt::AptEditor {
+
+using namespace AptTypes;
+
+namespace {
+
+// xmlEscape before appendXmlEscaped
+std::string xmlEscapeWithStream(const std::string_view source) {
+    auto destination = std::ostringstream{};
+    for (const auto character : source) {
+        switch (character) {
+        case '&':
+            destination << "&amp;";
+            break;
+        case '\'':
+            destination << "&apos;";
+            break;
+        case '"':
+            destination << "&quot;";
+            break;
+        case '<':
+            destination << "&lt;";
+            break;
+        case '>':
+            destination << "&gt;";
+            break;
+        default:
+            destination << character;
+            break;
+        }
+    }
+    return destination.str();
+}
+
+struct MovieText {
+    std::vector<std::string> strings;
+    std::vector<float> floats;
+    std::vector<std::int64_t> integers;
+    std::size_t stringBytes = 0;
+};
+
+MovieText collectText(const AptObjectPool& pool, const ConstFile::ConstData& constData) {
+    auto text = MovieText{};
+    const auto visitor = [&text](const auto& value, const AptType::NameStack&) {
+        using Type = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<Type, std::string>) {
+            text.strings.emplace_back(value);
+        }
+        else if constexpr (std::is_floating_point_v<Type>) {
+            text.floats.emplace_back(static_cast<float>(value));
+        }
+        else if constexpr (std::is_integral_v<Type>) {
+            text.integers.emplace_back(static_cast<std::int64_t>(value));
+        }
+    };
+    for (const auto& [address, object] : pool.objectInstances) {
+        object.forEachRecursive(visitor);
+    }
+    for (auto i = std::size_t{ 0 }; i < constData.itemCount(); ++i) {
+        if (constData.itemTypes[i] == ConstFile::ConstItemType::string) {
+            text.strings.emplace_back(constData.stringAt(i));
+        }
+    }
+    for (const auto& string : text.strings) {
+        text.stringBytes += string.size();
+    }
+    return text;
+}
+
+// runs f rounds times and prints how long it took; f returns a number of
+// characters written, summed up so that the work cannot be left out
+template <typename Function>
+std::size_t measure(const std::string_view what, const std::size_t rounds, Function&& f) {
+    const auto begin = std::chrono::steady_clock::now();
+    auto written = std::size_t{ 0 };
+    for (auto i = std::size_t{ 0 }; i < rounds; ++i) {
+        written += f();
+    }
+    const auto elapsed = std::chrono::duration<double, std::milli>{
+        std::chrono::steady_clock::now() - begin
+    };
+    std::cout << "  " << what << ": " << elapsed.count() << " ms, " << written
+              << " characters" << std::endl;
+    return written;
+}
+
+} // namespace
+
+void benchmarkXmlText(const std::filesystem::path& aptFileName) {
+    const auto constFileName =
+        std::filesystem::path{ aptFileName }.replace_extension(".const");
+    const auto constData = ConstFile::ConstData{ readEntireFile(constFileName) };
+    const auto text = collectText(parseApt(aptFileName, constData), constData);
+
+    // small movies are repeated until there is enough to measure
+    constexpr auto minimumStringBytes = std::size_t{ 16 } << 20;
+    constexpr auto minimumNumbers = std::size_t{ 1 } << 20;
+    const auto stringRounds = minimumStringBytes / (std::max)(text.stringBytes, std::size_t{ 1 }) + 1;
+    const auto numberCount = text.floats.size() + text.integers.size();
+    const auto numberRounds = minimumNumbers / (std::max)(numberCount, std::size_t{ 1 }) + 1;
+
+    std::cout << "Escaping " << text.strings.size() << " strings of " << text.stringBytes
+              << " bytes " << stringRounds << " times" << std::endl;
+    const auto streamEscaped = measure("ostringstream", stringRounds, [&text] {
+        auto written = std::size_t{ 0 };
+        for (const auto& string : text.strings) {
+            written += xmlEscapeWithStream(string).size();
+        }
+        return written;
+    });
+    auto output = std::string{};
+    const auto appendEscaped = measure("appendXmlEscaped", stringRounds, [&text, &output] {
+        output.clear();
+        for (const auto& string : text.strings) {
+            appendXmlEscaped(output, string);
+        }
+        return output.size();
+    });
+    for (const auto& string : text.strings) {
+        if (xmlEscapeWithStream(string) != xmlEscape(string)) {
+            throw std::logic_error{ "appendXmlEscaped differs on " + string };
+        }
+    }
+    if (streamEscaped != appendEscaped) {
+        throw std::logic_error{ "appendXmlEscaped wrote a different number of characters" };
+    }
+
+    std::cout << "Formatting " << text.floats.size() << " floats and " << text.integers.size()
+              << " integers " << numberRounds << " times" << std::endl;
+    measure("ostringstream", numberRounds, [&text] {
+        auto written = std::size_t{ 0 };
+        for (const auto value : text.floats) {
+            auto stream = std::ostringstream{};
+            stream << value;
+            written += stream.str().size();
+        }
+        for (const auto value : text.integers) {
+            auto stream = std::ostringstream{};
+            stream << value;
+            written += stream.str().size();
+        }
+        return written;
+    });
+    measure("tinyxml2 snprintf", numberRounds, [&text] {
+        auto written = std::size_t{ 0 };
+        auto buffer = std::array<char, 64>{};
+        for (const auto value : text.floats) {
+            tinyxml2::XMLUtil::ToStr(value, buffer.data(), static_cast<int>(buffer.size()));
+            written += std::char_traits<char>::length(buffer.data());
+        }
+        for (const auto value : text.integers) {
+            tinyxml2::XMLUtil::ToStr(static_cast<int>(value), buffer.data(),
+                                     static_cast<int>(buffer.size()));
+            written += std::char_traits<char>::length(buffer.data());
+        }
+        return written;
+    });
+    measure("to_chars", numberRounds, [&text] {
+        auto written = std::size_t{ 0 };
+        auto buffer = std::array<char, 64>{};
+        const auto format = [&buffer, &written](const auto value) {
+            const auto result = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+            written += static_cast<std::size_t>(result.ptr - buffer.data());
+        };
+        std::for_each(text.floats.begin(), text.floats.end(), format);
+        std::for_each(text.integers.begin(), text.integers.end(), format);
+        return written;
+    });
+}
+
+} // namespace Apt::AptEditor
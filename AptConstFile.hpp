@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <cstring>
 #include <variant>
 #include <algorithm>
 #include <array>
@@ -22,15 +23,13 @@ namespace Apt::ConstFile
         lookup = 8,
 	};
 
+    // a view of one item, string values point into the buffer owned by ConstData
     struct ConstItem {
-        template <typename Type>
-        ConstItem(ConstItemType typeID, Type value) : type{typeID}, data{value} {}
+        ConstItemType type;
+        std::variant<std::nullptr_t, std::string_view, std::uint32_t, bool, float, std::int32_t> data;
 
         template<typename T>
         const T& get() const { return std::get<T>(this->data); }
-
-		const ConstItemType type;
-        const std::variant<std::nullptr_t, std::string, std::uint32_t, bool, float, std::int32_t> data;
     };
 
     struct SkippedUnknwonConstData {
@@ -42,65 +41,171 @@ namespace Apt::ConstFile
     struct ConstData {
         static constexpr std::string_view constFileMagic = "Apt constant file\x1A\0\0"sv;
 
-        ConstData(const std::string_view data) {
+        // items are stored as a type array and a parallel array of raw 32 bit values,
+        // strings stay in the file buffer and are only validated here
+        ConstData(std::string fileContent) : buffer{ std::move(fileContent) } {
+            const auto data = std::string_view{ this->buffer };
             auto remainingBytes = data;
 
             if(splitFront(remainingBytes, this->constFileMagic.size()) != this->constFileMagic) {
                 throw std::runtime_error{"Apt magic not found"};
             }
             
+            // console versions store everything big endian, which shows in the item count:
+            // read the wrong way it does not fit in the file
+            const auto maxItemCount = remainingBytes.size() / 8;
+            const auto itemCountBytes = remainingBytes.substr(4, 4);
+            const auto littleItemCount = readCharsAs<std::uint32_t>(itemCountBytes);
+            const auto bigItemCount = readCharsAs<std::uint32_t, Endianness::big>(itemCountBytes);
+            if(littleItemCount > maxItemCount and bigItemCount <= maxItemCount) {
+                this->endianness = Endianness::big;
+                this->readItems<Endianness::big>(remainingBytes);
+            }
+            else {
+                this->readItems<Endianness::little>(remainingBytes);
+            }
+        }
+
+        std::size_t itemCount() const noexcept { return this->itemTypes.size(); }
+
+        std::string_view stringAt(const std::size_t index) const {
+            if(this->itemTypes.at(index) != ConstItemType::string) {
+                throw std::invalid_argument{"ConstItem " + std::to_string(index) + " is not a string"};
+            }
+            // the constructor made sure a terminator follows
+            return std::string_view{ this->buffer.data() + this->itemValues[index] };
+        }
+
+        ConstItem itemAt(const std::size_t index) const {
+            const auto type = this->itemTypes.at(index);
+            const auto rawValue = this->itemValues[index];
+            switch(type) {
+                case ConstItemType::string:
+                    return { type, this->stringAt(index) };
+                case ConstItemType::boolean:
+                    return { type, static_cast<bool>(rawValue) };
+                case ConstItemType::single:
+                    return { type, readCharsAs<float>(rawValueView(rawValue)) };
+                case ConstItemType::integer:
+                    return { type, static_cast<std::int32_t>(rawValue) };
+                default:
+                    return { type, rawValue };
+            }
+        }
+
+        // the new string is appended to the buffer, views returned earlier are invalidated;
+        // toBytes lays out all strings again
+        void setString(const std::size_t index, const std::string_view value) {
+            if(this->itemTypes.at(index) != ConstItemType::string) {
+                throw std::invalid_argument{"ConstItem " + std::to_string(index) + " is not a string"};
+            }
+            if(value.find('\0') != value.npos) {
+                throw std::invalid_argument{"Strings cannot contain null characters"};
+            }
+            this->itemValues[index] = static_cast<std::uint32_t>(this->buffer.size());
+            this->buffer.append(value);
+            this->buffer.push_back('\0');
+        }
+
+        // adds a string item after all others and returns its index, see setString
+        std::size_t appendString(const std::string_view value) {
+            if(value.find('\0') != value.npos) {
+                throw std::invalid_argument{"Strings cannot contain null characters"};
+            }
+            this->itemTypes.emplace_back(ConstItemType::string);
+            this->itemValues.emplace_back(0);
+            this->setString(this->itemTypes.size() - 1, value);
+            return this->itemTypes.size() - 1;
+        }
+
+        // same layout as the original files: header, items, then strings padded to 4 bytes,
+        // numbers in the byte order given by endianness
+        std::string toBytes() const {
+            const auto appendAs = [this](std::string& destination, auto value) {
+                if(this->endianness == Endianness::big) {
+                    value = byteSwapped(value);
+                }
+                destination.append(reinterpret_cast<const char*>(&value), sizeof(value));
+            };
+
+            const auto itemCount = static_cast<std::uint32_t>(this->itemTypes.size());
+            auto header = std::string{ this->constFileMagic };
+            appendAs(header, this->aptDataOffset);
+            appendAs(header, itemCount);
+            header.append(this->skippedUnknownData.unknown1.data(), this->skippedUnknownData.unknown1.size());
+
+            const auto stringsBegin = header.size() + itemCount * 2 * sizeof(std::uint32_t);
+            auto itemData = std::string{};
+            auto stringData = std::string{};
+            for (auto i = std::size_t{0}; i < this->itemTypes.size(); ++i) {
+                auto rawValue = this->itemValues[i];
+                if(this->itemTypes[i] == ConstItemType::string) {
+                    const auto value = this->stringAt(i);
+                    rawValue = static_cast<std::uint32_t>(stringsBegin + stringData.size());
+                    stringData += value;
+                    stringData.resize(stringData.size() + 4 - value.size() % 4, '\0');
+                }
+                appendAs(itemData, this->itemTypes[i]);
+                appendAs(itemData, rawValue);
+            }
+
+            return header + itemData + stringData;
+        }
+
+		uint32_t aptDataOffset;
+        std::vector<ConstItemType> itemTypes;
+        // string offset into buffer for strings, the value's bits otherwise
+        std::vector<std::uint32_t> itemValues;
+        SkippedUnknwonConstData skippedUnknownData;
+        // byte order of the file read, the values above are always native
+        Endianness endianness = Endianness::little;
+
+    private:
+        template<Endianness byteOrder>
+        void readItems(std::string_view remainingBytes) {
+            const auto data = std::string_view{ this->buffer };
+
             //read aptDataOffset
-            this->aptDataOffset = splitFrontAndReadAs<std::uint32_t>(remainingBytes);
+            this->aptDataOffset = splitFrontAndReadAs<std::uint32_t, byteOrder>(remainingBytes);
 
-            const auto itemCount = splitFrontAndReadAs<std::uint32_t>(remainingBytes);
+            const auto itemCount = splitFrontAndReadAs<std::uint32_t, byteOrder>(remainingBytes);
             //skip 4 bytes
             splitFrontAndCopyToArray(remainingBytes, this->skippedUnknownData.unknown1);
-            
+
+            // every string must be terminated, so it's enough to start before the last '\0'
+            const auto lastTerminator = data.rfind('\0');
+            this->itemTypes.reserve(itemCount);
+            this->itemValues.reserve(itemCount);
             for (auto i = std::uint32_t{0}; i < itemCount; ++i) {
-                const auto itemType = splitFrontAndReadAs<ConstItemType>(remainingBytes);
-                const auto rawValue = splitFront(remainingBytes, sizeof(std::uint32_t));
-                const auto unsignedItemValue = readCharsAs<std::uint32_t>(rawValue);
+                const auto itemType = splitFrontAndReadAs<ConstItemType, byteOrder>(remainingBytes);
+                const auto itemValue = splitFrontAndReadAs<std::uint32_t, byteOrder>(remainingBytes);
                 switch(itemType) {
                     case ConstItemType::string: {
-                        const auto itemstringStart = unsignedItemValue;
-                        const auto itemstringEnd = data.find('\0', itemstringStart);
-                        if(itemstringEnd > data.size()) {
+                        if(lastTerminator == data.npos or itemValue > lastTerminator) {
                             throw std::out_of_range{"Error when parsing ConstItem: itemstringEnd == data.npos"};
                         }
-                        const auto itemstring = data.substr(itemstringStart, itemstringEnd - itemstringStart);
-                        this->items.emplace_back(itemType, static_cast<std::string>(itemstring));
-                        break;
-                    }
-                    case ConstItemType::aptRegister: {
-                        this->items.emplace_back(itemType, unsignedItemValue);
-                        break;
-                    }
-                    case ConstItemType::boolean: {
-                        this->items.emplace_back(itemType, static_cast<bool>(unsignedItemValue));
-                        break;
-                    }
-                    case ConstItemType::single: {
-                        this->items.emplace_back(itemType, readCharsAs<float>(rawValue));
-                        break;
-                    }
-                    case ConstItemType::integer: {
-                        this->items.emplace_back(itemType, readCharsAs<std::int32_t>(rawValue));
                         break;
                     }
+                    case ConstItemType::aptRegister:
+                    case ConstItemType::boolean:
+                    case ConstItemType::single:
+                    case ConstItemType::integer:
                     case ConstItemType::lookup: {
-                        this->items.emplace_back(itemType, unsignedItemValue);
                         break;
                     }
                     default: {
                         throw std::invalid_argument{"Unknown type " + std::to_string(static_cast<int32_t>(itemType))};
                     }
                 }
+                this->itemTypes.push_back(itemType);
+                this->itemValues.push_back(itemValue);
             }
+        }
 
+        static std::string_view rawValueView(const std::uint32_t& rawValue) noexcept {
+            return { reinterpret_cast<const char*>(&rawValue), sizeof(rawValue) };
         }
 
-		uint32_t aptDataOffset;
-        std::vector<ConstItem> items;
-        SkippedUnknwonConstData skippedUnknownData;
+        std::string buffer;
     };
 }
\ No newline at end of file
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <ciso646>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "AptConstFile.hpp"
+#include "AptEditor.hpp"
+#include "Util.hpp"
+
+// reports which characters, frames, frame items and action streams differ
+// between two .apt files, by comparing subtree hashes from the top down
+namespace Apt::AptEditor {
+
+using namespace AptTypes;
+
+namespace {
+
+struct DiffSide {
+    const AptObjectPool& pool;
+    const SubtreeHashes& hashes;
+    Address entryOffset;
+
+    std::uint64_t hashOf(const Address address) const {
+        return this->hashes.objects.at(address);
+    }
+
+    const AptType& at(const Address address) const {
+        return this->pool.objectInstances.at(address);
+    }
+
+    // element index of the array member of object, pointers followed;
+    // 0 if there is no such element or it is a null pointer
+    Address element(const AptType& object,
+                    const std::string_view member,
+                    const std::size_t index) const {
+        const auto memberIndex = object.find(member);
+        if (not memberIndex.has_value()) {
+            return 0;
+        }
+        const auto& array = std::get<PointerToArray>(object.at(memberIndex.value()).value);
+        if (index >= array.length) {
+            return 0;
+        }
+        const auto& pointer = array.pointerToArray;
+        const auto elementSize = this->pool.getType(pointer.typePointedTo).size();
+        const auto address = pointer.address + static_cast<Address>(index * elementSize);
+        if (const auto& element = this->at(address);
+            std::holds_alternative<AptTypePointer>(element.value)) {
+            return std::get<AptTypePointer>(element.value).address;
+        }
+        return address;
+    }
+
+    std::size_t length(const AptType& object, const std::string_view member) const {
+        const auto memberIndex = object.find(member);
+        if (not memberIndex.has_value()) {
+            return 0;
+        }
+        return std::get<PointerToArray>(object.at(memberIndex.value()).value).length;
+    }
+};
+
+class Differ {
+public:
+    Differ(const DiffSide first, const DiffSide second, std::ostream& output) :
+        first{ first }, second{ second }, output{ output } {}
+
+    // returns false if nothing differs
+    bool compareMovies() {
+        const auto& movieA = this->first.at(this->first.entryOffset);
+        const auto& movieB = this->second.at(this->second.entryOffset);
+        if (this->first.hashOf(this->first.entryOffset) ==
+            this->second.hashOf(this->second.entryOffset)) {
+            return false;
+        }
+
+        this->compareValues(movieA, movieB, "movie ");
+        this->compareElements(movieA, movieB, "characters", "character", 0,
+                              [this](const AptType& a, const AptType& b, const int depth) {
+                                  this->compareElements(a, b, "frames", "frame", depth,
+                                                        this->frameItems());
+                              });
+        this->compareElements(movieA, movieB, "frames", "frame", 0, this->frameItems());
+        this->compareElements(movieA, movieB, "imports", "import", 0);
+        this->compareElements(movieA, movieB, "exports", "export", 0);
+        return true;
+    }
+
+private:
+    using Nested = std::function<void(const AptType&, const AptType&, int)>;
+
+    Nested frameItems() {
+        return [this](const AptType& a, const AptType& b, const int depth) {
+            this->compareElements(a, b, "frameItems", "frame item", depth, {});
+        };
+    }
+
+    // numbers of the object itself joined with their member names, pointed
+    // objects are compared by compareElements
+    static std::vector<std::pair<std::string, double>> numbersOf(const AptType& object) {
+        auto numbers = std::vector<std::pair<std::string, double>>{};
+        const auto visitor = [&numbers](const auto& value, const AptType::NameStack& nameStack) {
+            using Type = std::decay_t<decltype(value)>;
+            auto name = std::string{};
+            for (const auto& level : nameStack) {
+                name += name.empty() ? level : '.' + level;
+            }
+            // offsets of actions only say where they are stored
+            if constexpr (std::is_arithmetic_v<Type>) {
+                if (name != "actionDataOffset") {
+                    numbers.emplace_back(name, static_cast<double>(value));
+                }
+            }
+            else if constexpr (std::is_same_v<Type, Unsigned24>) {
+                numbers.emplace_back(name, static_cast<double>(value.value));
+            }
+        };
+        object.forEachRecursive(visitor);
+        return numbers;
+    }
+
+    void compareValues(const AptType& a, const AptType& b, const std::string& prefix) {
+        if (a.typeName != b.typeName) {
+            return;
+        }
+        const auto numbersA = numbersOf(a);
+        const auto numbersB = numbersOf(b);
+        for (auto i = std::size_t{ 0 }; i < (std::min)(numbersA.size(), numbersB.size()); ++i) {
+            const auto& [name, valueA] = numbersA[i];
+            const auto valueB = numbersB[i].second;
+            if (valueA != valueB) {
+                this->output << prefix << name << ": " << valueA << " -> " << valueB
+                             << std::endl;
+            }
+        }
+    }
+
+    void compareElements(const AptType& a,
+                         const AptType& b,
+                         const std::string_view member,
+                         const std::string& label,
+                         const int depth,
+                         const Nested& nested = {}) {
+        const auto indent = std::string(depth * 2, ' ');
+        const auto count = (std::max)(this->first.length(a, member),
+                                      this->second.length(b, member));
+        for (auto i = std::size_t{ 0 }; i < count; ++i) {
+            const auto addressA = this->first.element(a, member, i);
+            const auto addressB = this->second.element(b, member, i);
+            // the movie itself is usually character 0
+            if (addressA == this->first.entryOffset or addressB == this->second.entryOffset) {
+                continue;
+            }
+            if (addressA == 0 and addressB == 0) {
+                continue;
+            }
+            if (addressA == 0) {
+                this->output << indent << label << ' ' << i << " added ("
+                             << this->second.at(addressB).typeName << ')' << std::endl;
+                continue;
+            }
+            if (addressB == 0) {
+                this->output << indent << label << ' ' << i << " removed ("
+                             << this->first.at(addressA).typeName << ')' << std::endl;
+                continue;
+            }
+            if (this->first.hashOf(addressA) == this->second.hashOf(addressB)) {
+                continue;
+            }
+
+            const auto& elementA = this->first.at(addressA);
+            const auto& elementB = this->second.at(addressB);
+            if (elementA.typeName != elementB.typeName) {
+                this->output << indent << label << ' ' << i << " changed from "
+                             << elementA.typeName << " to " << elementB.typeName << std::endl;
+                continue;
+            }
+            this->output << indent << label << ' ' << i << " (" << elementA.typeName
+                         << ") changed";
+            if (const auto actions = elementA.find("actionDataOffset"); actions.has_value()) {
+                const auto streamA = elementA.at(actions.value()).getNumericValue<Address>();
+                const auto streamB = elementB.at(actions.value()).getNumericValue<Address>();
+                if (streamA == 0 or streamB == 0 or
+                    this->first.hashes.actionStreams.at(streamA) !=
+                        this->second.hashes.actionStreams.at(streamB)) {
+                    this->output << ", action stream differs";
+                }
+            }
+            this->output << std::endl;
+            this->compareValues(elementA, elementB, indent + "  ");
+            if (nested) {
+                nested(elementA, elementB, depth + 1);
+            }
+        }
+    }
+
+    DiffSide first;
+    DiffSide second;
+    std::ostream& output;
+};
+
+} // namespace
+
+bool diffApt(const std::filesystem::path& firstAptFileName,
+             const std::filesystem::path& secondAptFileName,
+             std::ostream& output) {
+    const auto readConst = [](const std::filesystem::path& aptFileName) {
+        const auto constFileName =
+            std::filesystem::path{ aptFileName }.replace_extension(".const");
+        return ConstFile::ConstData{ readEntireFile(constFileName) };
+    };
+    // scripts push const items by id, which may differ for the same items
+    const auto constA = readConst(firstAptFileName);
+    const auto constB = readConst(secondAptFileName);
+    const auto poolA = parseApt(firstAptFileName, constA);
+    const auto poolB = parseApt(secondAptFileName, constB);
+    const auto entryA = constA.aptDataOffset;
+    const auto entryB = constB.aptDataOffset;
+    const auto hashesA = hashSubtrees(poolA, entryA, &constA);
+    const auto hashesB = hashSubtrees(poolB, entryB, &constB);
+
+    auto differ = Differ{ DiffSide{ poolA, hashesA, entryA },
+                          DiffSide{ poolB, hashesB, entryB },
+                          output };
+    const auto differs = differ.compareMovies();
+    if (not differs) {
+        output << "No differences" << std::endl;
+    }
+    return differs;
+}
+
+} // namespace Apt::AptEditor
@@ -1,6 +1,200 @@
+#pragma once
+#include <cstdint>
 #include <filesystem>
+#include <iosfwd>
+#include <map>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "AptConstFile.hpp"
+#include "AptToXmlHints.hpp"
+#include "AptTypes.hpp"
 
 namespace Apt::AptEditor {
-void aptToXml(const std::filesystem::path& aptFileName);
-}
\ No newline at end of file
+// source instruction address -> (destination address, description)
+using DestinationMap =
+    std::map<AptTypes::Address, std::pair<AptTypes::Address, std::string>>;
+
+void loadTypeDefinitions(AptTypes::AptObjectPool& pool);
+// the movie is read from constData.aptDataOffset, in the byte order of constData;
+// see AptObjectPool::plainArraysAsSpans for plainArraysAsSpans
+AptTypes::AptObjectPool parseApt(const std::filesystem::path& aptFileName,
+                                 const ConstFile::ConstData& constData,
+                                 bool plainArraysAsSpans = false);
+// constructs root and everything it leads to, actions included
+void fetchReachableObjects(AptTypes::AptObjectPool& pool,
+                           AptTypes::Address root,
+                           std::string_view rootType);
+DestinationMap getDestinationMap(const AptTypes::AptObjectPool& pool);
+
+// AptHeaderData is kept as text, with non printable bytes escaped as "\xNN"
+std::string encodeHeaderData(std::string_view data);
+std::string decodeHeaderData(std::string_view encoded);
+
+// everything writeXml derives from the pool besides the objects themselves
+struct PoolIndex {
+    DestinationMap destinationMap;
+    AptToXmlHints::References references; // including branch destinations
+    AptToXmlHints::ParentMap parentMap;
+};
+PoolIndex indexPool(const AptTypes::AptObjectPool& pool, AptTypes::Address entryOffset);
+
+struct ParsedApt {
+    ConstFile::ConstData constData;
+    AptTypes::AptObjectPool pool;
+    PoolIndex index;
+};
+// with useCache, <apt>.aptcache is reused when its key still matches the input
+// files and rewritten otherwise, see AptPoolCache.cpp
+ParsedApt openApt(const std::filesystem::path& aptFileName, bool useCache);
+
+void writeXml(const AptTypes::AptObjectPool& pool,
+              const ConstFile::ConstData& constData,
+              const PoolIndex& index,
+              const std::filesystem::path& xmlFileName);
+// entryOffset is the root object; a pool without AptHeaderData is written as a
+// partial export which xmlToApt refuses to convert
+void writeXml(const AptTypes::AptObjectPool& pool,
+              const ConstFile::ConstData& constData,
+              const PoolIndex& index,
+              AptTypes::Address entryOffset,
+              const std::filesystem::path& xmlFileName);
+
+void aptToXml(const std::filesystem::path& aptFileName, bool useCache = false);
+// writes the same .xml as aptToXml, but converts the movie and then each character
+// on its own from the mapped .apt, so only one of them is in memory at a time;
+// throws if one would need more than about memoryLimit bytes
+void aptToXmlStreaming(const std::filesystem::path& aptFileName, std::size_t memoryLimit);
+struct XmlToAptOptions {
+    // identical objects, arrays and action streams are written once and shared by
+    // everything pointing to them; characters and imports are never shared, only
+    // what lies below them
+    bool deduplicate = false;
+    // the action streams go through optimizeActions first
+    bool optimize = false;
+    // and then through internStrings, which adds strings to the .edited.const
+    bool internStrings = false;
+};
+// returns the written .apt file
+std::filesystem::path xmlToApt(const std::filesystem::path& xmlFileName,
+                               const XmlToAptOptions& options = {});
+
+struct ActionOptimization {
+    std::size_t streams = 0;
+    std::size_t instructionsBefore = 0;
+    std::size_t instructionsAfter = 0;
+};
+// rewrites every action stream below aptDataNode in place: unreachable instructions
+// and branches to the next instruction are removed, branches to a BranchAlways go
+// straight to its destination, and PushData / call sequences become the shortest
+// EA instructions doing the same, see ActionOptimizer.cpp
+ActionOptimization optimizeActions(tinyxml2::XMLElement& aptDataNode,
+                                   const ConstFile::ConstData& constData);
+
+struct StringInterning {
+    std::size_t rewrittenInstructions = 0;
+    std::size_t addedStrings = 0;
+};
+// EA_PushString, EA_GetStringVar and EA_GetStringMember below aptDataNode become
+// EA_PushConstantByte / Word, EA_PushValueOfVar and EA_GetNamedMember where the
+// string is a .const item with a small enough index; strings which are not yet are
+// added to constData, the most used ones first
+StringInterning internStrings(tinyxml2::XMLElement& aptDataNode,
+                              ConstFile::ConstData& constData);
+
+// a pool with type definitions and the .apt data but no objects yet, to be filled
+// lazily through AptObjectPool::getObject / resolve / arrayElement; with mapFile the
+// .apt is mapped instead of read, so only the parts touched take memory, and it
+// must not be written while the pool is in use
+AptTypes::AptObjectPool openLazyPool(const std::filesystem::path& aptFileName,
+                                     const ConstFile::ConstData& constData,
+                                     bool mapFile = false);
+
+struct ExportEntry {
+    std::string name;
+    std::size_t characterID;
+    AptTypes::Address address = 0;                   // 0 if there is no such character
+    const AptTypes::AptType* character = nullptr;    // owned by the pool
+};
+std::vector<ExportEntry> getExports(AptTypes::AptObjectPool& pool,
+                                    AptTypes::Address entryOffset);
+// lists the exports of an .apt file and the characters they point to
+void printExports(const std::filesystem::path& aptFileName);
+// character is either a character index or an export name
+AptTypes::Address findCharacter(AptTypes::AptObjectPool& pool,
+                                AptTypes::Address entryOffset,
+                                std::string_view character);
+// writes only the subtree of one character, nested like in aptToXml, to
+// <apt>.<character>.xml; returns the written file
+std::filesystem::path characterToXml(const std::filesystem::path& aptFileName,
+                                     std::string_view character);
+
+// a field reached from the movie by a path like "frames.0.frameItems.1.translation.x":
+// member names and array indices separated by '.', pointers are followed implicitly
+struct FieldLocation {
+    AptTypes::Address address;
+    const AptTypes::AptType* field; // owned by the pool
+};
+FieldLocation locateField(AptTypes::AptObjectPool& pool,
+                          AptTypes::Address entryOffset,
+                          std::string_view path);
+
+struct PatchResult {
+    std::filesystem::path fileName; // the file holding the edit
+    bool inPlace;
+};
+// sets a number or string of the .apt, or const item i with the path "const.i".
+// The original file is patched in place when the new value fits; a longer .apt
+// string is written through xmlToApt instead and a longer const string rewrites
+// the .const file. Array lengths (numberOfFrames...) are refused.
+PatchResult patchApt(const std::filesystem::path& aptFileName,
+                     std::string_view path,
+                     std::string_view value);
+
+// writes the movie without the characters neither the movie nor its exports lead
+// to, shapes and images excepted, through <apt>.edited.xml and xmlToApt; their
+// elements of Movie.characters become null, so no index changes. Returns the
+// written .apt file, see AptStrip.cpp
+std::filesystem::path stripApt(const std::filesystem::path& aptFileName);
+
+// Merkle style hashes of each object together with everything it points to,
+// independent of addresses, see AptSubtreeHash.cpp
+struct SubtreeHashes {
+    std::map<AptTypes::Address, std::uint64_t> objects;
+    // instruction arrays, by the address of their first instruction
+    std::map<AptTypes::Address, std::uint64_t> actionStreams;
+};
+// with constData, const item ids are hashed as the items they refer to, so that
+// the same scripts compare equal whatever the .const files look like
+SubtreeHashes hashSubtrees(const AptTypes::AptObjectPool& pool,
+                           AptTypes::Address entryOffset,
+                           const ConstFile::ConstData* constData = nullptr);
+// prints the subtrees of an .apt file which appear more than once, largest first
+void printDuplicates(const std::filesystem::path& aptFileName);
+
+// prints how long escaping the strings and formatting the numbers of an .apt file
+// takes with appendXmlEscaped and to_chars and the ostringstream / snprintf way
+// they were written before, see AptBenchmark.cpp
+void benchmarkXmlText(const std::filesystem::path& aptFileName);
+// writes the characters, frames and action streams that differ to output,
+// returns false if the movies are the same
+bool diffApt(const std::filesystem::path& firstAptFileName,
+             const std::filesystem::path& secondAptFileName,
+             std::ostream& output);
+
+// answers conversion requests read line by line from input on threadCount
+// threads until "quit" or the end of input, see AptServer.cpp for the protocol
+void serve(std::istream& input, std::ostream& output, std::size_t threadCount);
+// runs serve on a script of requests about copies of the movie, made in a temporary
+// directory, and throws if a response is not the expected one, see AptServerCheck.cpp
+void checkServer(const std::filesystem::path& aptFileName);
+
+// binary snapshots (.aptsnap), see AptSnapshot.hpp
+void aptToSnapshot(const std::filesystem::path& aptFileName);
+void xmlToSnapshot(const std::filesystem::path& xmlFileName);
+void snapshotToXml(const std::filesystem::path& snapshotFileName);
+// returns the written .apt file
+std::filesystem::path snapshotToApt(const std::filesystem::path& snapshotFileName);
+}
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <ciso646>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <variant>
+
+#include "AptConstFile.hpp"
+#include "AptEditor.hpp"
+#include "AptTypes.hpp"
+#include "Util.hpp"
+
+// queries answered from a lazy pool: only the objects on the way from the
+// movie to what is asked for are read from the .apt
+namespace Apt::AptEditor {
+
+using namespace AptTypes;
+
+AptObjectPool openLazyPool(const std::filesystem::path& aptFileName,
+                           const ConstFile::ConstData& constData,
+                           const bool mapFile) {
+    auto pool = AptObjectPool{};
+    if (mapFile) {
+        const auto file = std::make_shared<const MappedFile>(aptFileName);
+        pool.dataSource.reset(file->view(), file);
+    }
+    else {
+        pool.dataSource.reset(readEntireFile(aptFileName));
+    }
+    loadTypeDefinitions(pool);
+    pool.sourceEndianness = constData.endianness;
+    return pool;
+}
+
+std::vector<ExportEntry> getExports(AptObjectPool& pool, const Address entryOffset) {
+    const auto& movie = pool.getObject(entryOffset, "Movie");
+    const auto& exports = std::get<PointerToArray>(movie.at("exports").value);
+    const auto& characters = std::get<PointerToArray>(movie.at("characters").value);
+
+    auto result = std::vector<ExportEntry>{};
+    for (auto i = std::size_t{ 0 }; i < exports.length; ++i) {
+        const auto& exported = pool.arrayElement(exports, i);
+        const auto* name =
+            pool.resolve(std::get<AptTypePointer>(exported.at("name").value));
+        const auto characterID = exported.at("character").getNumericValue<std::size_t>();
+
+        auto entry = ExportEntry{};
+        entry.name = name == nullptr ? std::string{} : std::get<std::string>(name->value);
+        entry.characterID = characterID;
+        if (characterID < characters.length) {
+            const auto& pointer =
+                std::get<AptTypePointer>(pool.arrayElement(characters, characterID).value);
+            entry.character = pool.resolve(pointer);
+            entry.address = pointer.address;
+        }
+        result.emplace_back(std::move(entry));
+    }
+    return result;
+}
+
+void printExports(const std::filesystem::path& aptFileName) {
+    const auto constFileName =
+        std::filesystem::path{ aptFileName }.replace_extension(".const");
+    const auto constData = ConstFile::ConstData{ readEntireFile(constFileName) };
+
+    auto pool = openLazyPool(aptFileName, constData);
+    for (const auto& entry : getExports(pool, constData.aptDataOffset)) {
+        std::cout << entry.name << " -> character " << entry.characterID;
+        if (entry.character != nullptr) {
+            std::cout << " (" << entry.character->typeName << " at " << entry.address
+                      << ")";
+        }
+        std::cout << std::endl;
+    }
+}
+
+Address findCharacter(AptObjectPool& pool,
+                      const Address entryOffset,
+                      const std::string_view character) {
+    const auto isDigit = [](const char c) {
+        return std::isdigit(static_cast<unsigned char>(c)) != 0;
+    };
+    if (character.empty() or not std::all_of(character.begin(), character.end(), isDigit)) {
+        for (const auto& entry : getExports(pool, entryOffset)) {
+            if (entry.name != character) {
+                continue;
+            }
+            if (entry.character == nullptr) {
+                throw std::runtime_error{ "Export " + entry.name + " has no character" };
+            }
+            return entry.address;
+        }
+        throw std::runtime_error{ "Cannot find any export named " + std::string{ character } };
+    }
+
+    auto index = std::size_t{ 0 };
+    const auto end = character.data() + character.size();
+    if (std::from_chars(character.data(), end, index).ptr != end) {
+        throw std::out_of_range{ "Invalid character index " + std::string{ character } };
+    }
+    const auto& movie = pool.getObject(entryOffset, "Movie");
+    const auto& characters = std::get<PointerToArray>(movie.at("characters").value);
+    const auto& pointer =
+        std::get<AptTypePointer>(pool.arrayElement(characters, index).value);
+    if (pointer.address == 0) {
+        throw std::runtime_error{ "Character " + std::string{ character } + " is empty" };
+    }
+    return pointer.address;
+}
+
+std::filesystem::path characterToXml(const std::filesystem::path& aptFileName,
+                                     const std::string_view character) {
+    const auto constFileName =
+        std::filesystem::path{ aptFileName }.replace_extension(".const");
+    const auto constData = ConstFile::ConstData{ readEntireFile(constFileName) };
+
+    auto pool = openLazyPool(aptFileName, constData);
+    const auto root = findCharacter(pool, constData.aptDataOffset, character);
+    // keep only the subtree, not the objects visited while looking for it
+    pool.objectInstances.clear();
+    pool.arrays.clear();
+    pool.plainArraysAsSpans = true;
+    fetchReachableObjects(pool, root, "Character");
+
+    // export names may contain anything
+    auto fileNamePart = std::string{ character };
+    for (auto& c : fileNamePart) {
+        if (not std::isalnum(static_cast<unsigned char>(c)) and c != '_' and c != '-') {
+            c = '_';
+        }
+    }
+    const auto xmlFileName =
+        std::filesystem::path{ aptFileName.string() + "." + fileNamePart + ".xml" };
+    const auto index = [&] {
+        try {
+            return indexPool(pool, root);
+        }
+        catch (const AptToXmlHints::SharedObjectError&) {
+            throw AptToXmlHints::sharedMovieError(aptFileName, "--character");
+        }
+    }();
+    writeXml(pool, constData, index, root, xmlFileName);
+    return xmlFileName;
+}
+
+} // namespace Apt::AptEditor
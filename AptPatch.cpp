@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <charconv>
+#include <ciso646>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "AptConstFile.hpp"
+#include "AptEditor.hpp"
+#include "AptTypes.hpp"
+#include "Util.hpp"
+
+// edits of single numbers and strings written straight into the original
+// .apt / .const, see patchApt
+namespace Apt::AptEditor {
+
+using namespace AptTypes;
+
+namespace {
+
+constexpr auto constPathPrefix = std::string_view{ "const." };
+
+template <typename T>
+T parseNumber(const std::string_view text) {
+    const auto error = [text] {
+        return std::invalid_argument{ "Invalid number " + std::string{ text } };
+    };
+    if constexpr (std::is_floating_point_v<T>) {
+        // from_chars for floating point is not available in every standard library yet
+        auto end = std::size_t{ 0 };
+        auto value = T{};
+        try {
+            value = std::stof(std::string{ text }, &end);
+        }
+        catch (const std::exception&) {
+            throw error();
+        }
+        if (end != text.size()) {
+            throw error();
+        }
+        return value;
+    }
+    else {
+        auto value = T{};
+        const auto* last = text.data() + text.size();
+        const auto [end, result] = std::from_chars(text.data(), last, value);
+        if (result != std::errc{} or end != last) {
+            throw error();
+        }
+        return value;
+    }
+}
+
+template <typename T>
+std::string bytesOf(const T value) {
+    // assuming little endian, see inByteOrder
+    auto bytes = std::string(sizeof(T), '\0');
+    std::memcpy(bytes.data(), &value, sizeof(T));
+    return bytes;
+}
+
+std::string inByteOrder(std::string bytes, const Endianness byteOrder) {
+    if (byteOrder == Endianness::big) {
+        std::reverse(bytes.begin(), bytes.end());
+    }
+    return bytes;
+}
+
+// little endian bytes of text parsed as the type of field
+std::string encodeNumber(const AptType& field, const std::string_view text) {
+    const auto visitor = [text, &field](const auto& value) -> std::string {
+        using Type = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<Type, Unsigned24>) {
+            const auto number = parseNumber<std::uint32_t>(text);
+            if (number > 0xFFFFFF) {
+                throw std::out_of_range{ std::string{ text } + " does not fit in 24 bits" };
+            }
+            return bytesOf(number).substr(0, 3);
+        }
+        else if constexpr (std::is_arithmetic_v<Type>) {
+            return bytesOf(parseNumber<Type>(text));
+        }
+        else {
+            throw std::invalid_argument{ "Only numbers and strings can be patched, not " +
+                                         field.typeName };
+        }
+    };
+    return std::visit(visitor, field.value);
+}
+
+// a string of the original file can grow into the zeros before the next
+// 4 byte boundary, where the next object starts at the earliest
+std::size_t stringSlotSize(const std::string_view data,
+                           const std::size_t offset,
+                           const std::size_t oldSize) {
+    const auto terminated = oldSize + 1;
+    const auto alignedEnd = (std::min)((offset + terminated + 3) / 4 * 4, data.size());
+    const auto padding = data.substr(offset + terminated, alignedEnd - offset - terminated);
+    if (not isAllZero(padding)) {
+        return terminated;
+    }
+    return alignedEnd - offset;
+}
+
+// the string padded with zeros to the whole slot, or nothing if it does not fit
+std::optional<std::string> fitString(const std::string_view value, const std::size_t slotSize) {
+    if (value.find('\0') != value.npos) {
+        throw std::invalid_argument{ "Strings cannot contain null characters" };
+    }
+    if (value.size() + 1 > slotSize) {
+        return std::nullopt;
+    }
+    auto bytes = std::string{ value };
+    bytes.resize(slotSize, '\0');
+    return bytes;
+}
+
+void writeBytesAt(const std::filesystem::path& fileName,
+                  const std::size_t offset,
+                  const std::string_view bytes) {
+    auto file = std::fstream{ fileName, std::ios::in | std::ios::out | std::ios::binary };
+    file.seekp(offset);
+    file.write(bytes.data(), bytes.size());
+    if (not file) {
+        throw std::runtime_error{ "Cannot write to " + fileName.string() };
+    }
+}
+
+PatchResult patchConstItem(const std::filesystem::path& constFileName,
+                           const std::string_view indexText,
+                           const std::string_view value) {
+    const auto constFileData = readEntireFile(constFileName);
+    auto constData = ConstFile::ConstData{ constFileData };
+    const auto index = parseNumber<std::size_t>(indexText);
+    if (index >= constData.itemCount()) {
+        throw std::out_of_range{ "Invalid const item " + std::string{ indexText } };
+    }
+
+    const auto type = constData.itemTypes[index];
+    if (type != ConstFile::ConstItemType::string) {
+        auto bytes = std::string{};
+        switch (type) {
+        case ConstFile::ConstItemType::boolean:
+            bytes = bytesOf(std::uint32_t{
+                value == "true" or (value != "false" and parseNumber<std::uint32_t>(value) != 0) });
+            break;
+        case ConstFile::ConstItemType::single:
+            bytes = bytesOf(parseNumber<float>(value));
+            break;
+        case ConstFile::ConstItemType::integer:
+            bytes = bytesOf(parseNumber<std::int32_t>(value));
+            break;
+        default:
+            bytes = bytesOf(parseNumber<std::uint32_t>(value));
+            break;
+        }
+        const auto itemsBegin =
+            ConstFile::ConstData::constFileMagic.size() + 3 * sizeof(std::uint32_t);
+        const auto valueOffset = itemsBegin + index * 2 * sizeof(std::uint32_t) +
+                                 sizeof(ConstFile::ConstItemType);
+        writeBytesAt(constFileName, valueOffset, inByteOrder(bytes, constData.endianness));
+        return PatchResult{ constFileName, true };
+    }
+
+    // strings shared by several items (see XMLToApt deduplication) are rewritten
+    const auto offset = constData.itemValues[index];
+    auto users = 0;
+    for (auto i = std::size_t{ 0 }; i < constData.itemCount(); ++i) {
+        if (constData.itemTypes[i] == ConstFile::ConstItemType::string and
+            constData.itemValues[i] == offset) {
+            ++users;
+        }
+    }
+    if (users == 1) {
+        const auto slotSize =
+            stringSlotSize(constFileData, offset, constData.stringAt(index).size());
+        if (const auto bytes = fitString(value, slotSize); bytes.has_value()) {
+            writeBytesAt(constFileName, offset, bytes.value());
+            return PatchResult{ constFileName, true };
+        }
+    }
+
+    constData.setString(index, value);
+    auto output = std::ofstream{ constFileName, std::ios::binary };
+    const auto bytes = constData.toBytes();
+    output.write(bytes.data(), bytes.size());
+    if (not output) {
+        throw std::runtime_error{ "Cannot write to " + constFileName.string() };
+    }
+    return PatchResult{ constFileName, false };
+}
+
+// how many pointers of the whole movie lead to address; movies written with
+// deduplication share identical strings
+std::size_t countPointersTo(const AptObjectPool& pool, const Address address) {
+    auto count = std::size_t{ 0 };
+    const auto visitor = [address, &count](const auto& value, const AptType::NameStack&) {
+        using Type = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<Type, AptTypePointer>) {
+            if (value.address == address) {
+                ++count;
+            }
+        }
+    };
+    for (const auto& [objectAddress, object] : pool.objectInstances) {
+        object.forEachRecursive(visitor);
+    }
+    return count;
+}
+
+// every pointer to address has its bytes somewhere in the file, so if they are
+// found only once, that is the pointer which led there; otherwise the whole
+// movie is parsed to count the real pointers
+bool hasOnePointerTo(const std::filesystem::path& aptFileName,
+                     const ConstFile::ConstData& constData,
+                     const AptObjectPool& pool,
+                     const Address address) {
+    const auto data = pool.dataSource.bytes();
+    const auto pointer = inByteOrder(bytesOf(address), pool.sourceEndianness);
+    const auto first = data.find(pointer);
+    if (first == data.npos or data.find(pointer, first + 1) == data.npos) {
+        return true;
+    }
+    return countPointersTo(parseApt(aptFileName, constData), address) == 1;
+}
+
+// the length of an array is the number of elements written for it, changing
+// only the number would make the game read past the array or skip part of it
+void checkNotArrayLength(AptObjectPool& pool,
+                         const Address entryOffset,
+                         const std::string_view path) {
+    const auto separator = path.rfind('.');
+    const auto parentPath = separator == path.npos ? std::string_view{} : path.substr(0, separator);
+    const auto memberName = path.substr(separator == path.npos ? 0 : separator + 1);
+    const auto* parent = locateField(pool, entryOffset, parentPath).field;
+    if (not std::holds_alternative<AptType::MemberArray>(parent->value)) {
+        return;
+    }
+    for (const auto& [name, member] : std::get<AptType::MemberArray>(parent->value)) {
+        if (const auto* array = std::get_if<PointerToArray>(&member.value);
+            array != nullptr and array->arraySizeVariable == memberName) {
+            throw std::invalid_argument{ std::string{ path } + " is the length of " + name +
+                                         ", which only changes with the elements in the .xml" };
+        }
+    }
+}
+
+} // namespace
+
+FieldLocation locateField(AptObjectPool& pool,
+                          const Address entryOffset,
+                          std::string_view path) {
+    auto location = FieldLocation{ entryOffset, &pool.getObject(entryOffset, "Movie") };
+    // pointers are followed as if their target was the member itself
+    const auto followPointers = [&pool, &location] {
+        while (std::holds_alternative<AptTypePointer>(location.field->value)) {
+            const auto& pointer = std::get<AptTypePointer>(location.field->value);
+            const auto* target = pool.resolve(pointer);
+            if (target == nullptr) {
+                throw std::runtime_error{ "Null pointer in path" };
+            }
+            location = FieldLocation{ pointer.address, target };
+        }
+    };
+
+    while (not path.empty()) {
+        const auto segment = readUntil(path, ".");
+        followPointers();
+        const auto& current = *location.field;
+
+        if (std::holds_alternative<PointerToArray>(current.value)) {
+            const auto& array = std::get<PointerToArray>(current.value);
+            const auto index = parseNumber<std::size_t>(segment);
+            const auto& element = pool.arrayElement(array, index);
+            const auto elementSize = pool.getType(array.pointerToArray.typePointedTo).size();
+            location = FieldLocation{
+                array.pointerToArray.address + static_cast<Address>(index * elementSize),
+                &element
+            };
+            continue;
+        }
+
+        if (not std::holds_alternative<AptType::MemberArray>(current.value)) {
+            throw std::invalid_argument{ current.typeName + " has no member named " +
+                                         std::string{ segment } };
+        }
+        auto memberOffset = Address{ 0 };
+        const AptType* found = nullptr;
+        for (const auto& [memberName, member] : std::get<AptType::MemberArray>(current.value)) {
+            if (memberName == segment) {
+                found = &member;
+                break;
+            }
+            memberOffset += static_cast<Address>(member.size());
+        }
+        if (found == nullptr) {
+            throw std::out_of_range{ "Cannot find any member named " + std::string{ segment } +
+                                     " in " + current.typeName };
+        }
+        location = FieldLocation{ location.address + memberOffset, found };
+    }
+
+    followPointers();
+    return location;
+}
+
+PatchResult patchApt(const std::filesystem::path& aptFileName,
+                     const std::string_view path,
+                     const std::string_view value) {
+    const auto constFileName =
+        std::filesystem::path{ aptFileName }.replace_extension(".const");
+    if (path.substr(0, constPathPrefix.size()) == constPathPrefix) {
+        return patchConstItem(constFileName, path.substr(constPathPrefix.size()), value);
+    }
+
+    const auto constData = ConstFile::ConstData{ readEntireFile(constFileName) };
+    auto pool = openLazyPool(aptFileName, constData);
+    const auto [address, field] = locateField(pool, constData.aptDataOffset, path);
+
+    if (not std::holds_alternative<std::string>(field->value)) {
+        checkNotArrayLength(pool, constData.aptDataOffset, path);
+        writeBytesAt(aptFileName, address,
+                     inByteOrder(encodeNumber(*field, value), pool.sourceEndianness));
+        return PatchResult{ aptFileName, true };
+    }
+
+    // a string shared with other fields cannot be changed in place, like in patchConstItem
+    const auto& oldValue = std::get<std::string>(field->value);
+    const auto slotSize = stringSlotSize(pool.dataSource.bytes(), address, oldValue.size());
+    const auto bytes = fitString(value, slotSize);
+    if (bytes.has_value() and hasOnePointerTo(aptFileName, constData, pool, address)) {
+        writeBytesAt(aptFileName, address, bytes.value());
+        return PatchResult{ aptFileName, true };
+    }
+
+    // too long or shared: lay out the whole movie again, like editing the xml would;
+    // movies with shared objects are refused instead of changing all their users
+    auto parsed = [&aptFileName] {
+        try {
+            return openApt(aptFileName, false);
+        }
+        catch (const AptToXmlHints::SharedObjectError&) {
+            throw AptToXmlHints::sharedMovieError(aptFileName, "--set");
+        }
+    }();
+    std::get<std::string>(parsed.pool.objectInstances.at(address).value) = value;
+    const auto xmlFileName = aptFileName.string() + ".edited.xml";
+    writeXml(parsed.pool, parsed.constData, parsed.index, xmlFileName);
+    return PatchResult{ xmlToApt(xmlFileName), false };
+}
+
+} // namespace Apt::AptEditor
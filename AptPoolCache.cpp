@@ -0,0 +1,195 @@
+#include <array>
+#include <ciso646>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "AptEditor.hpp"
+#include "AptSnapshot.hpp"
+#include "ByteBuffer.hpp"
+#include "Util.hpp"
+
+// <apt>.aptcache: a CacheHeader, the pool as an .aptsnap snapshot and the
+// serialized PoolIndex. The key hashes the .apt, the .const and the type
+// definition files, so editing any of them invalidates the cache.
+namespace Apt::AptEditor {
+
+using namespace AptTypes;
+
+namespace {
+
+struct CacheHeader {
+    static constexpr auto magicValue =
+        std::array<char, 8>{ 'A', 'p', 't', 'C', 'a', 'c', 'h', 'e' };
+    static constexpr auto currentVersion = std::uint32_t{ 1 };
+
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t snapshotSize;
+    std::uint64_t key;
+    std::uint32_t indexSize;
+    std::uint32_t reserved;
+};
+
+void appendString(ByteBuffer& output, const std::string_view text) {
+    output.append(static_cast<std::uint32_t>(text.size()));
+    output.appendBytes(text.data(), text.size());
+}
+
+std::string readString(std::string_view& input) {
+    const auto length = splitFrontAndReadAs<std::uint32_t>(input);
+    return std::string{ splitFront(input, length) };
+}
+
+ByteBuffer serializePoolIndex(const PoolIndex& index) {
+    auto output = ByteBuffer{};
+    output.append(static_cast<std::uint32_t>(index.destinationMap.size()));
+    for (const auto& [source, destination] : index.destinationMap) {
+        const auto& [destinationAddress, description] = destination;
+        output.append(source);
+        output.append(destinationAddress);
+        appendString(output, description);
+    }
+
+    output.append(static_cast<std::uint32_t>(index.references.size()));
+    for (const auto& [address, count] : index.references) {
+        output.append(address);
+        output.append(static_cast<std::uint32_t>(count));
+    }
+
+    output.append(static_cast<std::uint32_t>(index.parentMap.size()));
+    for (const auto& [address, parent] : index.parentMap) {
+        const auto& [parentAddress, parentPath] = parent;
+        output.append(address);
+        output.append(parentAddress);
+        output.append(static_cast<std::uint32_t>(parentPath.size()));
+        for (const auto& name : parentPath) {
+            appendString(output, name);
+        }
+    }
+    return output;
+}
+
+PoolIndex deserializePoolIndex(std::string_view input) {
+    auto index = PoolIndex{};
+    for (auto count = splitFrontAndReadAs<std::uint32_t>(input); count > 0; --count) {
+        const auto source = splitFrontAndReadAs<Address>(input);
+        const auto destinationAddress = splitFrontAndReadAs<Address>(input);
+        index.destinationMap.emplace(source, std::pair{ destinationAddress, readString(input) });
+    }
+
+    for (auto count = splitFrontAndReadAs<std::uint32_t>(input); count > 0; --count) {
+        const auto address = splitFrontAndReadAs<Address>(input);
+        index.references.emplace(address, splitFrontAndReadAs<std::uint32_t>(input));
+    }
+
+    for (auto count = splitFrontAndReadAs<std::uint32_t>(input); count > 0; --count) {
+        const auto address = splitFrontAndReadAs<Address>(input);
+        const auto parentAddress = splitFrontAndReadAs<Address>(input);
+        auto parentPath = AptType::NameStack(splitFrontAndReadAs<std::uint32_t>(input));
+        for (auto& name : parentPath) {
+            name = readString(input);
+        }
+        index.parentMap.emplace(address, std::pair{ parentAddress, std::move(parentPath) });
+    }
+
+    if (not input.empty()) {
+        throw std::runtime_error{ "Unexpected data after pool index" };
+    }
+    return index;
+}
+
+std::uint64_t cacheKey(const std::string_view aptData, const std::string_view constData) {
+    auto key = hashBytes(aptData);
+    key = hashBytes(constData, key);
+    for (const auto* definitionFile :
+         { "AptTypeDefinitions.txt", "ActionTypeDeclarations.txt", "ActionTypeDefinitions.txt" }) {
+        key = hashBytes(readEntireFile(definitionFile), key);
+    }
+    return key;
+}
+
+// nullopt when there is no usable cache for this key
+std::optional<ParsedApt> readCache(const std::filesystem::path& cacheFileName,
+                                   const std::uint64_t key) {
+    if (not std::filesystem::exists(cacheFileName)) {
+        return std::nullopt;
+    }
+
+    const auto data = readEntireFile(cacheFileName);
+    auto remaining = std::string_view{ data };
+    const auto header = splitFrontAndReadAs<CacheHeader>(remaining);
+    if (header.magic != CacheHeader::magicValue or
+        header.version != CacheHeader::currentVersion or header.key != key) {
+        return std::nullopt;
+    }
+
+    // the snapshot directly follows the 32 byte header, so it stays aligned
+    const auto snapshot = AptSnapshot::SnapshotView{ splitFront(remaining, header.snapshotSize) };
+    const auto indexData = splitFront(remaining, header.indexSize);
+    return ParsedApt{ ConstFile::ConstData{ std::string{ snapshot.constFileData() } },
+                      AptSnapshot::snapshotToPool(snapshot),
+                      deserializePoolIndex(indexData) };
+}
+
+void writeCache(const std::filesystem::path& cacheFileName,
+                const std::uint64_t key,
+                const ParsedApt& parsed) {
+    const auto snapshot =
+        AptSnapshot::makeSnapshot(parsed.pool,
+                                  parsed.constData,
+                                  static_cast<std::uint32_t>(parsed.pool.dataSource.bytes().size()));
+    const auto index = serializePoolIndex(parsed.index);
+
+    auto header = CacheHeader{};
+    header.magic = CacheHeader::magicValue;
+    header.version = CacheHeader::currentVersion;
+    header.snapshotSize = static_cast<std::uint32_t>(snapshot.size());
+    header.key = key;
+    header.indexSize = static_cast<std::uint32_t>(index.size());
+    header.reserved = 0;
+
+    auto output = std::ofstream{ cacheFileName, std::ios::binary };
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(snapshot.data(), snapshot.size());
+    const auto indexData = index.view();
+    output.write(indexData.data(), indexData.size());
+}
+
+} // namespace
+
+ParsedApt openApt(const std::filesystem::path& aptFileName, const bool useCache) {
+    const auto constFileName =
+        std::filesystem::path{ aptFileName }.replace_extension(".const");
+    auto constFileData = readEntireFile(constFileName);
+
+    if (not useCache) {
+        auto constData = ConstFile::ConstData{ std::move(constFileData) };
+        auto pool = parseApt(aptFileName, constData, true);
+        auto index = indexPool(pool, constData.aptDataOffset);
+        return ParsedApt{ std::move(constData), std::move(pool), std::move(index) };
+    }
+
+    const auto cacheFileName = aptFileName.string() + ".aptcache";
+    const auto key = cacheKey(readEntireFile(aptFileName), constFileData);
+    try {
+        if (auto cached = readCache(cacheFileName, key); cached.has_value()) {
+            return std::move(cached.value());
+        }
+    }
+    catch (const std::exception&) {
+        // a damaged cache is simply rebuilt
+    }
+
+    auto parsed = openApt(aptFileName, false);
+    // snapshots hold objects only
+    parsed.pool.expandPlainArrays();
+    writeCache(cacheFileName, key, parsed);
+    return parsed;
+}
+
+} // namespace Apt::AptEditor
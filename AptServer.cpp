@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <ciso646>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <istream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "AptEditor.hpp"
+#include "Util.hpp"
+
+// Long running conversion server. Requests are read one per line and answered
+// in the order they complete, fields are separated by tabs:
+//
+//   <id> toxml <apt>                  -> <id> ok <written .xml>
+//   <id> toapt <xml>                  -> <id> ok <written .apt>
+//   <id> exports <apt>                -> <id> ok <name>=<character index>...
+//   <id> character <apt> <character>  -> <id> ok <written .xml>
+//   <id> set <apt> <path> <value>     -> <id> ok inplace|rewritten <written file>
+//   quit                              -> stop reading, pending requests still finish
+//
+// Failures are answered with <id> error <message>. Type definitions are loaded
+// once, and the pools of recently converted .apt files are kept in memory until
+// the files change.
+namespace Apt::AptEditor {
+
+using namespace AptTypes;
+
+namespace {
+
+class ThreadPool {
+public:
+    explicit ThreadPool(const std::size_t threadCount) {
+        for (auto i = std::size_t{ 0 }; i < threadCount; ++i) {
+            this->workers.emplace_back([this] { this->run(); });
+        }
+    }
+
+    // queued tasks are still run before the workers stop
+    ~ThreadPool() {
+        {
+            auto lock = std::lock_guard<std::mutex>{ this->mutex };
+            this->stopping = true;
+        }
+        this->condition.notify_all();
+        for (auto& worker : this->workers) {
+            worker.join();
+        }
+    }
+
+    void post(std::function<void()> task) {
+        {
+            auto lock = std::lock_guard<std::mutex>{ this->mutex };
+            this->tasks.push(std::move(task));
+        }
+        this->condition.notify_one();
+    }
+
+private:
+    void run() {
+        while (true) {
+            auto task = std::function<void()>{};
+            {
+                auto lock = std::unique_lock<std::mutex>{ this->mutex };
+                this->condition.wait(
+                    lock, [this] { return this->stopping or not this->tasks.empty(); });
+                if (this->tasks.empty()) {
+                    return;
+                }
+                task = std::move(this->tasks.front());
+                this->tasks.pop();
+            }
+            task();
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::queue<std::function<void()>> tasks;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+// most recently used parsed .apt files, reused while the .apt and .const are unchanged
+class ParsedAptCache {
+public:
+    std::shared_ptr<const ParsedApt> open(const std::filesystem::path& aptFileName) {
+        const auto key = aptFileName.lexically_normal().string();
+        const auto stamp = this->stampOf(aptFileName);
+        {
+            auto lock = std::lock_guard<std::mutex>{ this->mutex };
+            for (auto entry = this->entries.begin(); entry != this->entries.end(); ++entry) {
+                if (entry->key == key and entry->stamp == stamp) {
+                    this->entries.splice(this->entries.begin(), this->entries, entry);
+                    return entry->parsed;
+                }
+            }
+        }
+
+        // parsed without holding the lock, other files can be served meanwhile
+        auto parsed = std::make_shared<const ParsedApt>(openApt(aptFileName, false));
+        auto lock = std::lock_guard<std::mutex>{ this->mutex };
+        this->forgetLocked(key);
+        this->entries.push_front(Entry{ key, stamp, parsed });
+        if (this->entries.size() > capacity) {
+            this->entries.pop_back();
+        }
+        return parsed;
+    }
+
+    void forget(const std::filesystem::path& aptFileName) {
+        auto lock = std::lock_guard<std::mutex>{ this->mutex };
+        this->forgetLocked(aptFileName.lexically_normal().string());
+    }
+
+private:
+    static constexpr auto capacity = std::size_t{ 8 };
+
+    struct Stamp {
+        std::filesystem::file_time_type aptTime;
+        std::filesystem::file_time_type constTime;
+        std::uintmax_t aptSize;
+
+        bool operator==(const Stamp& other) const {
+            return aptTime == other.aptTime and constTime == other.constTime and
+                   aptSize == other.aptSize;
+        }
+    };
+
+    struct Entry {
+        std::string key;
+        Stamp stamp;
+        std::shared_ptr<const ParsedApt> parsed;
+    };
+
+    static Stamp stampOf(const std::filesystem::path& aptFileName) {
+        const auto constFileName =
+            std::filesystem::path{ aptFileName }.replace_extension(".const");
+        return Stamp{ std::filesystem::last_write_time(aptFileName),
+                      std::filesystem::last_write_time(constFileName),
+                      std::filesystem::file_size(aptFileName) };
+    }
+
+    void forgetLocked(const std::string& key) {
+        this->entries.remove_if([&key](const Entry& entry) { return entry.key == key; });
+    }
+
+    std::mutex mutex;
+    std::list<Entry> entries;
+};
+
+// requests about the same movie (foo.apt, foo.apt.edited.xml, foo.edited.apt...)
+// read and write the same files, so they are run one after another in the order
+// they came in; requests about different movies run in parallel
+class MovieQueues {
+public:
+    explicit MovieQueues(const std::size_t threadCount) : threads{ threadCount } {}
+
+    void post(const std::filesystem::path& fileName, std::function<void()> task) {
+        auto name = fileName.filename().string();
+        name = name.substr(0, name.find('.'));
+        const auto movie = (fileName.parent_path() / name).lexically_normal().string();
+        {
+            auto lock = std::lock_guard<std::mutex>{ this->mutex };
+            auto& queue = this->queues[movie];
+            queue.push(std::move(task));
+            if (queue.size() > 1) {
+                // the thread running the front will get to it
+                return;
+            }
+        }
+        this->threads.post([this, movie] { this->run(movie); });
+    }
+
+private:
+    void run(const std::string& movie) {
+        while (true) {
+            auto task = std::function<void()>{};
+            {
+                auto lock = std::lock_guard<std::mutex>{ this->mutex };
+                // the front stays in the queue while it runs
+                task = std::move(this->queues.at(movie).front());
+            }
+            task();
+            auto lock = std::lock_guard<std::mutex>{ this->mutex };
+            auto& queue = this->queues.at(movie);
+            queue.pop();
+            if (queue.empty()) {
+                this->queues.erase(movie);
+                return;
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::map<std::string, std::queue<std::function<void()>>> queues;
+    // destroyed first, so every queued task has run before the queues go away
+    ThreadPool threads;
+};
+
+std::vector<std::string> splitFields(std::string_view line) {
+    if (not line.empty() and line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    auto fields = std::vector<std::string>{};
+    while (not line.empty()) {
+        fields.emplace_back(readUntil(line, "\t"));
+    }
+    return fields;
+}
+
+class Server {
+public:
+    // returns the response fields after the request id
+    std::string handle(const std::vector<std::string>& fields) {
+        const auto& command = fields.at(1);
+        const auto argument = [&fields, &command](const std::size_t index) -> const std::string& {
+            if (index + 2 >= fields.size()) {
+                throw std::invalid_argument{ command + " expects more arguments" };
+            }
+            return fields[index + 2];
+        };
+
+        const auto fileName = std::filesystem::path{ argument(0) };
+        if (command == "toxml") {
+            const auto parsed = this->parsedApts.open(fileName);
+            const auto xmlFileName = fileName.string() + ".edited.xml";
+            writeXml(parsed->pool, parsed->constData, parsed->index, xmlFileName);
+            return "ok\t" + xmlFileName;
+        }
+        if (command == "toapt") {
+            return "ok\t" + xmlToApt(fileName).string();
+        }
+        if (command == "exports") {
+            const auto constFileName =
+                std::filesystem::path{ fileName }.replace_extension(".const");
+            const auto constData = ConstFile::ConstData{ readEntireFile(constFileName) };
+            auto pool = openLazyPool(fileName, constData);
+            auto response = std::string{ "ok" };
+            for (const auto& entry : getExports(pool, constData.aptDataOffset)) {
+                response += asString('\t', entry.name, '=', entry.characterID);
+            }
+            return response;
+        }
+        if (command == "character") {
+            return "ok\t" + characterToXml(fileName, argument(1)).string();
+        }
+        if (command == "set") {
+            const auto result = patchApt(fileName, argument(1), argument(2));
+            this->parsedApts.forget(fileName);
+            return std::string{ result.inPlace ? "ok\tinplace\t" : "ok\trewritten\t" } +
+                   result.fileName.string();
+        }
+        throw std::invalid_argument{ "Unknown command " + command };
+    }
+
+private:
+    ParsedAptCache parsedApts;
+};
+
+} // namespace
+
+void serve(std::istream& input, std::ostream& output, const std::size_t threadCount) {
+    auto server = Server{};
+    auto outputMutex = std::mutex{};
+    const auto respond = [&output, &outputMutex](const std::string& id,
+                                                 const std::string& response) {
+        auto line = id + '\t' + response;
+        for (auto& character : line) {
+            if (character == '\n' or character == '\r') {
+                character = ' ';
+            }
+        }
+        auto lock = std::lock_guard<std::mutex>{ outputMutex };
+        output << line << std::endl;
+    };
+
+    // destroyed before server, so every request is answered first
+    auto queues = MovieQueues{ (std::max)(threadCount, std::size_t{ 1 }) };
+    for (auto line = std::string{}; std::getline(input, line);) {
+        auto fields = splitFields(line);
+        if (fields.empty()) {
+            continue;
+        }
+        if (fields.front() == "quit") {
+            break;
+        }
+        if (fields.size() < 3) {
+            respond(fields.front(), "error\tmissing command or file");
+            continue;
+        }
+        const auto fileName = std::filesystem::path{ fields[2] };
+        queues.post(fileName, [&server, &respond, fields = std::move(fields)] {
+            try {
+                respond(fields.front(), server.handle(fields));
+            }
+            catch (const std::exception& e) {
+                respond(fields.front(), std::string{ "error\t" } + e.what());
+            }
+        });
+    }
+}
+
+} // namespace Apt::AptEditor
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <ciso646>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AptConstFile.hpp"
+#include "AptEditor.hpp"
+#include "Util.hpp"
+
+// Feeds serve a fixed script of requests about two copies of a movie and checks
+// what comes back: every request before "quit" is answered once and nothing after
+// it, requests about the same movie are answered in the order they were sent, a
+// toxml after a set sees the new value instead of the cached pool, and bad
+// requests are answered with errors.
+namespace Apt::AptEditor {
+
+using namespace AptTypes;
+
+namespace {
+
+struct Response {
+    std::size_t position; // in the order of the output lines
+    std::vector<std::string> fields;
+};
+
+void expect(const bool condition, const std::string_view what) {
+    if (not condition) {
+        throw std::runtime_error{ "Server check failed: " + std::string{ what } };
+    }
+}
+
+void copyMovie(const std::filesystem::path& aptFileName, const std::filesystem::path& copy) {
+    const auto options = std::filesystem::copy_options::overwrite_existing;
+    std::filesystem::copy_file(aptFileName, copy, options);
+    std::filesystem::copy_file(std::filesystem::path{ aptFileName }.replace_extension(".const"),
+                               std::filesystem::path{ copy }.replace_extension(".const"),
+                               options);
+}
+
+std::uint32_t readScreenWidth(const std::filesystem::path& aptFileName) {
+    const auto constFileName =
+        std::filesystem::path{ aptFileName }.replace_extension(".const");
+    const auto constData = ConstFile::ConstData{ readEntireFile(constFileName) };
+    auto pool = openLazyPool(aptFileName, constData);
+    const auto location = locateField(pool, constData.aptDataOffset, "screenWidth");
+    return location.field->getNumericValue<std::uint32_t>();
+}
+
+bool xmlContains(const std::filesystem::path& xmlFileName, const std::string_view text) {
+    return readEntireFile(xmlFileName).find(text) != std::string::npos;
+}
+
+} // namespace
+
+void checkServer(const std::filesystem::path& aptFileName) {
+    const auto directory = std::filesystem::temp_directory_path() / "AptEditorServerCheck";
+    std::filesystem::create_directories(directory);
+    const auto first = directory / "first.apt";
+    const auto second = directory / "second.apt";
+    copyMovie(aptFileName, first);
+    copyMovie(aptFileName, second);
+
+    const auto oldWidth = readScreenWidth(first);
+    const auto newWidth = oldWidth + 1;
+    const auto missing = directory / "missing.apt";
+    auto requests = std::ostringstream{};
+    requests << "1\ttoxml\t" << first.string() << '\n'
+             << "2\tset\t" << first.string() << "\tscreenWidth\t" << newWidth << '\n'
+             << "3\ttoxml\t" << first.string() << '\n'
+             << "4\ttoxml\t" << second.string() << '\n'
+             << "5\texports\t" << first.string() << '\n'
+             << "6\tfrobnicate\t" << first.string() << '\n'
+             << "7\ttoxml\t" << missing.string() << '\n'
+             << "8\n"
+             << "quit\n"
+             << "9\ttoxml\t" << first.string() << '\n';
+    auto input = std::istringstream{ requests.str() };
+    auto output = std::ostringstream{};
+    serve(input, output, 4);
+
+    auto responses = std::map<std::string, Response>{};
+    auto lines = std::istringstream{ output.str() };
+    for (auto line = std::string{}; std::getline(lines, line);) {
+        auto fields = std::vector<std::string>{};
+        for (auto rest = std::string_view{ line }; not rest.empty();) {
+            fields.emplace_back(readUntil(rest, "\t"));
+        }
+        expect(fields.size() >= 2, "response without a status: " + line);
+        const auto id = fields.front();
+        const auto position = responses.size();
+        expect(responses.emplace(id, Response{ position, std::move(fields) }).second,
+               "request " + id + " answered twice");
+    }
+    expect(responses.size() == 8, asString(responses.size(), " responses instead of 8"));
+    expect(responses.count("9") == 0, "a request after quit was answered");
+
+    const auto status = [&responses](const std::string& id) -> const std::string& {
+        return responses.at(id).fields.at(1);
+    };
+    for (const auto* id : { "1", "2", "3", "4", "5" }) {
+        expect(status(id) == "ok", asString("request ", id, " failed: ",
+                                            responses.at(id).fields.back()));
+    }
+    for (const auto* id : { "6", "7", "8" }) {
+        expect(status(id) == "error", asString("request ", id, " did not fail"));
+    }
+    expect(responses.at("2").fields.at(2) == "inplace", "screenWidth was not patched in place");
+
+    // one after another for the same movie, whichever thread picked them up
+    const auto sameMovie = { "1", "2", "3", "5", "6" };
+    expect(std::is_sorted(sameMovie.begin(), sameMovie.end(),
+                          [&responses](const char* left, const char* right) {
+                              return responses.at(left).position <
+                                     responses.at(right).position;
+                          }),
+           "requests about the same movie were answered out of order");
+
+    expect(xmlContains(responses.at("3").fields.at(2), asString("screenWidth=\"", newWidth, '"')),
+           "toxml after set wrote the old value");
+    expect(xmlContains(responses.at("4").fields.at(2), asString("screenWidth=\"", oldWidth, '"')),
+           "set changed another movie");
+
+    std::filesystem::remove_all(directory);
+    std::cout << "Server check passed" << std::endl;
+}
+
+} // namespace Apt::AptEditor
@@ -0,0 +1,383 @@
+#include <ciso646>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "AptEditor.hpp"
+#include "AptSnapshot.hpp"
+#include "AptTypes.hpp"
+#include "Util.hpp"
+
+namespace Apt::AptSnapshot {
+
+using namespace AptTypes;
+
+namespace {
+
+template <typename T>
+constexpr FieldKind fieldKindOf() {
+    if constexpr (std::is_same_v<T, std::uint8_t>) {
+        return FieldKind::unsigned8;
+    }
+    else if constexpr (std::is_same_v<T, std::uint16_t>) {
+        return FieldKind::unsigned16;
+    }
+    else if constexpr (std::is_same_v<T, Unsigned24>) {
+        return FieldKind::unsigned24;
+    }
+    else if constexpr (std::is_same_v<T, std::int32_t>) {
+        return FieldKind::int32;
+    }
+    else if constexpr (std::is_same_v<T, std::uint32_t>) {
+        return FieldKind::unsigned32;
+    }
+    else if constexpr (std::is_same_v<T, float>) {
+        return FieldKind::float32;
+    }
+    else if constexpr (std::is_same_v<T, std::string>) {
+        return FieldKind::string;
+    }
+    else if constexpr (std::is_same_v<T, AptTypePointer>) {
+        return FieldKind::pointer;
+    }
+    else if constexpr (std::is_same_v<T, PointerToArray>) {
+        return FieldKind::pointerToArray;
+    }
+    else {
+        static_assert(std::is_same_v<T, PaddingForAlignment>);
+        return FieldKind::padding;
+    }
+}
+
+class StringTable {
+public:
+    StringTable() { this->intern({}); }
+
+    std::uint32_t intern(const std::string_view text) {
+        if (const auto found = this->offsets.find(text); found != this->offsets.end()) {
+            return found->second;
+        }
+        const auto offset = static_cast<std::uint32_t>(this->data.size());
+        this->data += text;
+        this->data += '\0';
+        this->offsets.emplace(std::string{ text }, offset);
+        return offset;
+    }
+
+    std::string data;
+
+private:
+    std::map<std::string, std::uint32_t, std::less<>> offsets;
+};
+
+template <typename T>
+std::uint32_t rawValueOf(const T& value, StringTable& strings) {
+    if constexpr (std::is_same_v<T, Unsigned24>) {
+        return value.value;
+    }
+    else if constexpr (std::is_same_v<T, std::string>) {
+        return strings.intern(value);
+    }
+    else if constexpr (std::is_same_v<T, AptTypePointer>) {
+        return value.address;
+    }
+    else if constexpr (std::is_same_v<T, PointerToArray>) {
+        return value.pointerToArray.address;
+    }
+    else if constexpr (std::is_same_v<T, PaddingForAlignment>) {
+        return value.actuallyPadded;
+    }
+    else if constexpr (sizeof(T) == sizeof(std::uint32_t)) {
+        auto bits = std::uint32_t{};
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+    else {
+        return value;
+    }
+}
+
+class SnapshotWriter {
+public:
+    template <typename Record>
+    Section appendSection(const std::vector<Record>& records) {
+        return this->appendSection(std::string_view{ reinterpret_cast<const char*>(records.data()),
+                                                     records.size() * sizeof(Record) },
+                                   records.size());
+    }
+
+    Section appendSection(const std::string_view characters) {
+        return this->appendSection(characters, characters.size());
+    }
+
+    std::string data = std::string(sizeof(SnapshotHeader), '\0');
+
+private:
+    Section appendSection(const std::string_view bytes, const std::size_t count) {
+        this->data.resize(this->data.size() + (4 - this->data.size() % 4) % 4, '\0');
+        const auto section = Section{ static_cast<std::uint32_t>(count),
+                                      static_cast<std::uint32_t>(this->data.size()) };
+        this->data += bytes;
+        return section;
+    }
+};
+
+void readFields(AptType& object,
+                const SnapshotView& snapshot,
+                const FieldRecord*& field,
+                const FieldRecord* const fieldsEnd) {
+    if (std::holds_alternative<AptType::MemberArray>(object.value)) {
+        for (auto& [memberName, member] : std::get<AptType::MemberArray>(object.value)) {
+            readFields(member, snapshot, field, fieldsEnd);
+        }
+        AptObjectPool::setArrayLengths(object);
+        return;
+    }
+
+    if (field == fieldsEnd) {
+        throw std::runtime_error{ "Snapshot object has less fields than " + object.typeName };
+    }
+
+    const auto visitor = [&snapshot, &field](auto& value) {
+        using Type = std::decay_t<decltype(value)>;
+        if constexpr (not std::is_same_v<Type, AptType::MemberArray>) {
+            if (field->kind != fieldKindOf<Type>()) {
+                throw std::runtime_error{ "Snapshot field kind does not match the schema" };
+            }
+            const auto raw = field->value;
+            if constexpr (std::is_same_v<Type, Unsigned24>) {
+                value.value = raw;
+            }
+            else if constexpr (std::is_same_v<Type, std::string>) {
+                value = snapshot.stringAt(raw);
+            }
+            else if constexpr (std::is_same_v<Type, AptTypePointer>) {
+                value.address = raw;
+            }
+            else if constexpr (std::is_same_v<Type, PointerToArray>) {
+                value.pointerToArray.address = raw;
+            }
+            else if constexpr (std::is_same_v<Type, PaddingForAlignment>) {
+                value.actuallyPadded = raw;
+            }
+            else if constexpr (sizeof(Type) == sizeof(raw)) {
+                std::memcpy(&value, &raw, sizeof(value));
+            }
+            else {
+                value = static_cast<Type>(raw);
+            }
+        }
+    };
+    std::visit(visitor, object.value);
+    ++field;
+}
+
+} // namespace
+
+std::string makeSnapshot(const AptObjectPool& pool,
+                         const ConstFile::ConstData& constData,
+                         const std::uint32_t aptSize) {
+    auto strings = StringTable{};
+    auto typeIDs = std::map<std::string, std::uint32_t, std::less<>>{};
+    auto types = std::vector<TypeRecord>{};
+    auto objects = std::vector<ObjectRecord>{};
+    auto fields = std::vector<FieldRecord>{};
+    auto aptHeader = std::string{};
+
+    objects.reserve(pool.objectInstances.size());
+    for (const auto& [address, object] : pool.objectInstances) {
+        if (object.typeName == "AptHeaderData") {
+            aptHeader = AptEditor::decodeHeaderData(std::get<std::string>(object.value));
+            continue;
+        }
+
+        auto [typeID, inserted] =
+            typeIDs.emplace(object.typeName, static_cast<std::uint32_t>(types.size()));
+        if (inserted) {
+            types.push_back(TypeRecord{ strings.intern(object.typeName) });
+        }
+
+        const auto firstField = static_cast<std::uint32_t>(fields.size());
+        const auto fieldVisitor = [&strings, &fields](const auto& value,
+                                                      const AptType::NameStack& nameStack) {
+            using Type = std::decay_t<decltype(value)>;
+            // forEachRecursive only calls this for leaves
+            if constexpr (not std::is_same_v<Type, AptType::MemberArray>) {
+                auto name = std::string{};
+                for (const auto& memberName : nameStack) {
+                    name += name.empty() ? "" : ".";
+                    name += memberName;
+                }
+                fields.push_back(FieldRecord{
+                    fieldKindOf<Type>(), strings.intern(name), rawValueOf(value, strings) });
+            }
+        };
+        object.forEachRecursive(fieldVisitor);
+
+        objects.push_back(ObjectRecord{ address,
+                                        typeID->second,
+                                        firstField,
+                                        static_cast<std::uint32_t>(fields.size()) - firstField });
+    }
+
+    auto arrays = std::vector<ArrayRecord>{};
+    arrays.reserve(pool.arrays.size());
+    for (const auto& [begin, pastTheEnd] : pool.arrays) {
+        arrays.push_back(ArrayRecord{ begin, pastTheEnd });
+    }
+
+    auto header = SnapshotHeader{};
+    header.magic = SnapshotHeader::magicValue;
+    header.version = SnapshotHeader::currentVersion;
+    header.entryOffset = constData.aptDataOffset;
+    header.aptSize = aptSize;
+
+    auto writer = SnapshotWriter{};
+    header.types = writer.appendSection(types);
+    header.objects = writer.appendSection(objects);
+    header.fields = writer.appendSection(fields);
+    header.arrays = writer.appendSection(arrays);
+    header.strings = writer.appendSection(strings.data);
+    header.aptHeader = writer.appendSection(aptHeader);
+    header.constFile = writer.appendSection(constData.toBytes());
+    std::memcpy(writer.data.data(), &header, sizeof(header));
+    return std::move(writer.data);
+}
+
+AptObjectPool snapshotToPool(const SnapshotView& snapshot) {
+    auto pool = AptObjectPool{};
+    AptEditor::loadTypeDefinitions(pool);
+
+    if (const auto aptHeader = snapshot.aptHeaderData(); not aptHeader.empty()) {
+        pool.insertObject(AptType{ "AptHeaderData",
+                                   "AptHeaderData",
+                                   AptEditor::encodeHeaderData(aptHeader),
+                                   aptHeader.size() },
+                          0);
+    }
+
+    for (auto i = std::size_t{ 0 }; i < snapshot.objectCount(); ++i) {
+        const auto& record = snapshot.object(i);
+        auto object = pool.getType(snapshot.typeName(record));
+        const auto* field = snapshot.fields(record);
+        const auto* const fieldsEnd = field + record.fieldCount;
+        readFields(object, snapshot, field, fieldsEnd);
+        if (field != fieldsEnd) {
+            throw std::runtime_error{ "Snapshot object has more fields than " + object.typeName };
+        }
+        pool.insertObject(std::move(object), record.address);
+    }
+
+    for (auto i = std::size_t{ 0 }; i < snapshot.arrayCount(); ++i) {
+        const auto& array = snapshot.array(i);
+        pool.insertArrayData(array.begin, array.pastTheEnd);
+    }
+
+    return pool;
+}
+
+std::string snapshotToAptBytes(const SnapshotView& snapshot) {
+    auto output = DataDestination{};
+    output.data.resize(snapshot.header().aptSize);
+    output.getViewAt(0).writeFront(snapshot.aptHeaderData());
+
+    for (auto i = std::size_t{ 0 }; i < snapshot.objectCount(); ++i) {
+        const auto& record = snapshot.object(i);
+        auto writer = output.getViewAt(record.address);
+        const auto* fields = snapshot.fields(record);
+        for (auto j = std::size_t{ 0 }; j < record.fieldCount; ++j) {
+            const auto& field = fields[j];
+            switch (field.kind) {
+            case FieldKind::unsigned8:
+                writer.writeFrontAs(static_cast<std::uint8_t>(field.value));
+                break;
+            case FieldKind::unsigned16:
+                writer.writeFrontAs(static_cast<std::uint16_t>(field.value));
+                break;
+            case FieldKind::unsigned24:
+                writerWriteValue(writer, Unsigned24{ field.value });
+                break;
+            case FieldKind::string:
+                writer.writeFront(snapshot.stringAt(field.value));
+                writer.writeFrontAs('\0');
+                break;
+            case FieldKind::padding:
+                writer.skipFront(field.value);
+                break;
+            default:
+                writer.writeFrontAs(field.value);
+                break;
+            }
+        }
+    }
+
+    return std::move(output.data);
+}
+
+} // namespace Apt::AptSnapshot
+
+namespace Apt::AptEditor {
+
+namespace {
+
+std::string readSnapshotFile(const std::filesystem::path& snapshotFileName) {
+    auto bytes = readEntireFile(snapshotFileName);
+    // validate once here, so the callers can construct views freely
+    AptSnapshot::SnapshotView{ bytes };
+    return bytes;
+}
+
+void writeBinaryFile(const std::filesystem::path& fileName, const std::string_view bytes) {
+    auto output = std::ofstream{ fileName, std::ios::binary };
+    output.write(bytes.data(), bytes.size());
+}
+
+} // namespace
+
+void aptToSnapshot(const std::filesystem::path& aptFileName) {
+    const auto constFileName =
+        std::filesystem::path{ aptFileName }.replace_extension(".const");
+    const auto constData = ConstFile::ConstData(readEntireFile(constFileName));
+    const auto pool = parseApt(aptFileName, constData);
+    const auto aptSize = static_cast<std::uint32_t>(pool.dataSource.bytes().size());
+    writeBinaryFile(aptFileName.string() + ".aptsnap",
+                    AptSnapshot::makeSnapshot(pool, constData, aptSize));
+}
+
+void snapshotToXml(const std::filesystem::path& snapshotFileName) {
+    const auto bytes = readSnapshotFile(snapshotFileName);
+    const auto snapshot = AptSnapshot::SnapshotView{ bytes };
+    const auto constData = ConstFile::ConstData{ std::string{ snapshot.constFileData() } };
+    const auto pool = AptSnapshot::snapshotToPool(snapshot);
+    // x.apt.aptsnap -> x.apt.edited.xml, same as aptToXml
+    const auto aptFileName = std::filesystem::path{ snapshotFileName }.replace_extension();
+    const auto index = indexPool(pool, constData.aptDataOffset);
+    writeXml(pool, constData, index, aptFileName.string() + ".edited.xml");
+}
+
+std::filesystem::path snapshotToApt(const std::filesystem::path& snapshotFileName) {
+    const auto bytes = readSnapshotFile(snapshotFileName);
+    const auto snapshot = AptSnapshot::SnapshotView{ bytes };
+
+    auto baseName = std::filesystem::path{ snapshotFileName }.replace_extension();
+    if (baseName.extension() == ".apt") {
+        baseName.replace_extension();
+    }
+    const auto aptFileName = std::filesystem::path{ baseName }.concat(".edited.apt");
+    const auto constFileName = std::filesystem::path{ baseName }.concat(".edited.const");
+
+    writeBinaryFile(aptFileName, AptSnapshot::snapshotToAptBytes(snapshot));
+    writeBinaryFile(constFileName, snapshot.constFileData());
+    return aptFileName;
+}
+
+void xmlToSnapshot(const std::filesystem::path& xmlFileName) {
+    aptToSnapshot(xmlToApt(xmlFileName));
+}
+
+} // namespace Apt::AptEditor
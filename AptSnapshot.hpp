@@ -0,0 +1,234 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <ciso646>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "AptConstFile.hpp"
+#include "AptTypes.hpp"
+#include "Util.hpp"
+
+// Binary snapshot of a parsed AptObjectPool (.aptsnap).
+//
+// Every number is a little endian 32 bit value and every section starts at a
+// 4 byte aligned offset from the beginning of the file, so a snapshot loaded or
+// mapped into memory can be queried in place:
+//
+//   SnapshotHeader
+//   types    TypeRecord[]    schema ID -> type name, as in the type definition files
+//   objects  ObjectRecord[]  sorted by address, each one owns a run of fields
+//   fields   FieldRecord[]   leaf values of every object in declaration order
+//   arrays   ArrayRecord[]   the (begin, past the end) array table of the pool
+//   strings  char[]          '\0' terminated, referenced by offset (0 is "")
+//   aptHeader char[]         raw bytes before the first parsed object of the .apt
+//   constFile char[]         the whole .const file
+namespace Apt::AptSnapshot {
+
+using AptTypes::Address;
+
+// same order as the alternatives of AptType::Value, minus MemberArray
+enum class FieldKind : std::uint32_t {
+    unsigned8 = 0,
+    unsigned16 = 1,
+    unsigned24 = 2,
+    int32 = 3,
+    unsigned32 = 4,
+    float32 = 5,
+    string = 6,     // value is a string table offset
+    pointer = 7,    // value is the address pointed to
+    pointerToArray = 8,
+    padding = 9,    // value is the number of padded bytes
+};
+
+struct Section {
+    std::uint32_t count; // element count, or byte count for character sections
+    std::uint32_t offset;
+};
+
+struct SnapshotHeader {
+    static constexpr auto magicValue =
+        std::array<char, 8>{ 'A', 'p', 't', 'S', 'n', 'a', 'p', '\0' };
+    static constexpr auto currentVersion = std::uint32_t{ 1 };
+
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    Address entryOffset;
+    std::uint32_t aptSize;
+    Section types;
+    Section objects;
+    Section fields;
+    Section arrays;
+    Section strings;
+    Section aptHeader;
+    Section constFile;
+};
+
+struct TypeRecord {
+    std::uint32_t name;
+};
+
+struct ObjectRecord {
+    Address address;
+    std::uint32_t typeID;
+    std::uint32_t firstField;
+    std::uint32_t fieldCount;
+};
+
+struct FieldRecord {
+    FieldKind kind;
+    std::uint32_t name; // member names joined with '.', "" for objects without members
+    std::uint32_t value;
+};
+
+struct ArrayRecord {
+    Address begin;
+    Address pastTheEnd;
+};
+
+// read only access to a snapshot, nothing is copied out of the buffer
+class SnapshotView {
+public:
+    explicit SnapshotView(const std::string_view bytes) : bytes{ bytes } {
+        if (reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(std::uint32_t) != 0) {
+            throw std::invalid_argument{ "Snapshot buffer is not aligned" };
+        }
+        if (bytes.size() < sizeof(SnapshotHeader)) {
+            throw std::runtime_error{ "Snapshot is too small" };
+        }
+        const auto& header = this->header();
+        if (header.magic != SnapshotHeader::magicValue) {
+            throw std::runtime_error{ "Snapshot magic not found" };
+        }
+        if (header.version != SnapshotHeader::currentVersion) {
+            throw std::runtime_error{ "Unsupported snapshot version " +
+                                      std::to_string(header.version) };
+        }
+        this->checkSection<TypeRecord>(header.types);
+        this->checkSection<ObjectRecord>(header.objects);
+        this->checkSection<FieldRecord>(header.fields);
+        this->checkSection<ArrayRecord>(header.arrays);
+        this->checkSection<char>(header.strings);
+        this->checkSection<char>(header.aptHeader);
+        this->checkSection<char>(header.constFile);
+        const auto& strings = header.strings;
+        if (strings.count == 0 or this->bytes[strings.offset + strings.count - 1] != '\0') {
+            throw std::runtime_error{ "Snapshot string table is not terminated" };
+        }
+    }
+
+    const SnapshotHeader& header() const {
+        return *reinterpret_cast<const SnapshotHeader*>(this->bytes.data());
+    }
+
+    std::size_t objectCount() const { return this->header().objects.count; }
+    const ObjectRecord& object(const std::size_t index) const {
+        return this->records<ObjectRecord>(this->header().objects)[index];
+    }
+
+    const ObjectRecord* findObject(const Address address) const {
+        const auto* begin = this->records<ObjectRecord>(this->header().objects);
+        const auto* end = begin + this->objectCount();
+        const auto byAddress = [](const ObjectRecord& record, const Address value) {
+            return record.address < value;
+        };
+        const auto* found = std::lower_bound(begin, end, address, byAddress);
+        return (found != end and found->address == address) ? found : nullptr;
+    }
+
+    std::string_view typeName(const ObjectRecord& object) const {
+        if (object.typeID >= this->header().types.count) {
+            throw std::out_of_range{ "Invalid schema ID " + std::to_string(object.typeID) };
+        }
+        const auto* types = this->records<TypeRecord>(this->header().types);
+        return this->stringAt(types[object.typeID].name);
+    }
+
+    // the fieldCount records starting here belong to object
+    const FieldRecord* fields(const ObjectRecord& object) const {
+        const auto fieldCount = std::size_t{ this->header().fields.count };
+        if (object.firstField > fieldCount or
+            object.fieldCount > fieldCount - object.firstField) {
+            throw std::out_of_range{ "Invalid field range of object at " +
+                                     std::to_string(object.address) };
+        }
+        return this->records<FieldRecord>(this->header().fields) + object.firstField;
+    }
+
+    const FieldRecord& field(const ObjectRecord& object, const std::size_t index) const {
+        if (index >= object.fieldCount) {
+            throw std::out_of_range{ "Invalid field index " + std::to_string(index) };
+        }
+        return this->fields(object)[index];
+    }
+
+    const FieldRecord* findField(const ObjectRecord& object,
+                                 const std::string_view name) const {
+        for (auto i = std::size_t{ 0 }; i < object.fieldCount; ++i) {
+            const auto& field = this->field(object, i);
+            if (this->stringAt(field.name) == name) {
+                return &field;
+            }
+        }
+        return nullptr;
+    }
+
+    std::string_view fieldName(const FieldRecord& field) const {
+        return this->stringAt(field.name);
+    }
+
+    std::string_view stringAt(const std::uint32_t offset) const {
+        const auto& strings = this->header().strings;
+        if (offset >= strings.count) {
+            throw std::out_of_range{ "Invalid string offset " + std::to_string(offset) };
+        }
+        // the table is known to end with '\0'
+        return std::string_view{ this->bytes.data() + strings.offset + offset };
+    }
+
+    std::size_t arrayCount() const { return this->header().arrays.count; }
+    const ArrayRecord& array(const std::size_t index) const {
+        return this->records<ArrayRecord>(this->header().arrays)[index];
+    }
+
+    std::string_view aptHeaderData() const {
+        return this->characters(this->header().aptHeader);
+    }
+    std::string_view constFileData() const {
+        return this->characters(this->header().constFile);
+    }
+
+private:
+    template <typename Record>
+    void checkSection(const Section& section) const {
+        if (section.offset % alignof(std::uint32_t) != 0 or
+            section.offset > this->bytes.size() or
+            section.count > (this->bytes.size() - section.offset) / sizeof(Record)) {
+            throw std::runtime_error{ "Snapshot section out of range" };
+        }
+    }
+
+    template <typename Record>
+    const Record* records(const Section& section) const {
+        return reinterpret_cast<const Record*>(this->bytes.data() + section.offset);
+    }
+
+    std::string_view characters(const Section& section) const {
+        return this->bytes.substr(section.offset, section.count);
+    }
+
+    std::string_view bytes;
+};
+
+std::string makeSnapshot(const AptTypes::AptObjectPool& pool,
+                         const ConstFile::ConstData& constData,
+                         std::uint32_t aptSize);
+// type definitions are loaded into the returned pool to rebuild each object
+AptTypes::AptObjectPool snapshotToPool(const SnapshotView& snapshot);
+// the .apt bytes are written straight from the field records
+std::string snapshotToAptBytes(const SnapshotView& snapshot);
+
+} // namespace Apt::AptSnapshot
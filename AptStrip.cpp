@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <ciso646>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "AptConstFile.hpp"
+#include "AptEditor.hpp"
+#include "AptTypes.hpp"
+#include "Util.hpp"
+
+// Characters nothing leads to are dropped from a movie: starting from the movie,
+// every index into Movie.characters held by what has been reached so far (placed
+// objects, button records, exports, imports, fonts of text fields, sprites of
+// init actions, morph shapes) is followed. Scripts can only create characters
+// through their export names, so exported characters are always kept. Shapes and
+// Images are kept too, since the geometry files refer to them by index, and the
+// dropped characters leave null pointers so that no index changes.
+namespace Apt::AptEditor {
+
+using namespace AptTypes;
+
+namespace {
+
+struct CharacterIndexMember {
+    std::string_view typeName;
+    std::string_view memberName;
+};
+
+// everything holding an index into Movie.characters
+constexpr CharacterIndexMember characterIndexMembers[] = {
+    { "PlaceObject", "character" },  { "ButtonRecord", "character" },
+    { "Export", "character" },       { "Import", "character" },
+    { "EditText", "font" },          { "InitAction", "sprite" },
+    { "Morph", "startShape" },       { "Morph", "endShape" },
+};
+
+// calls f with each member of object which holds a character index
+template <typename Object, typename Function>
+void forEachCharacterIndex(Object& object, Function&& f) {
+    for (const auto& [typeName, memberName] : characterIndexMembers) {
+        if (object.typeName != typeName) {
+            continue;
+        }
+        if (const auto member = object.find(memberName); member.has_value()) {
+            f(object.at(member.value()));
+        }
+    }
+}
+
+// a value which is not an index of the array, like the character of a
+// PlaceObject which only moves what is at its depth, is left as it is
+std::size_t characterIndexOf(const AptType& member, const std::size_t characterCount) {
+    const auto value = member.getNumericValue<std::int64_t>();
+    if (value < 0 or static_cast<std::uint64_t>(value) >= characterCount) {
+        return characterCount;
+    }
+    return static_cast<std::size_t>(value);
+}
+
+// what the .ru geometry files may refer to, which is not read here
+bool isReferencedByGeometry(const AptType& character) {
+    return character.typeName == "Shape" or character.typeName == "Image";
+}
+
+// which elements of Movie.characters are reached from the movie
+std::vector<bool> findUsedCharacters(const AptObjectPool& pool, const Address entryOffset) {
+    const auto& movie = pool.objectInstances.at(entryOffset);
+    const auto& characters = std::get<PointerToArray>(movie.at("characters").value);
+    const auto characterAddress = [&pool, &characters](const std::size_t index) {
+        const auto elementAddress =
+            characters.pointerToArray.address + static_cast<Address>(index * 4);
+        return std::get<AptTypePointer>(pool.objectInstances.at(elementAddress).value).address;
+    };
+
+    auto used = std::vector<bool>(characters.length, false);
+    auto pending = std::vector<Address>{ entryOffset };
+    for (auto i = std::size_t{ 0 }; i < characters.length; ++i) {
+        const auto address = characterAddress(i);
+        if (address == entryOffset) {
+            used[i] = true;
+        }
+        else if (address != 0 and isReferencedByGeometry(pool.objectInstances.at(address))) {
+            used[i] = true;
+            pending.emplace_back(address);
+        }
+    }
+    auto visited = std::set<Address>{};
+    // the characters array is followed through the indices only
+    const auto visitor = [&pool, &pending](const auto& value, const AptType::NameStack& names) {
+        using Type = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<Type, AptTypePointer>) {
+            if (value.address != 0) {
+                pending.emplace_back(value.address);
+            }
+        }
+        else if constexpr (std::is_same_v<Type, PointerToArray>) {
+            if (not names.empty() and names.back() == "characters") {
+                return;
+            }
+            const auto& pointer = value.pointerToArray;
+            const auto elementSize = pool.getType(pointer.typePointedTo).size();
+            for (auto i = std::size_t{ 0 }; i < value.length; ++i) {
+                pending.emplace_back(pointer.address + static_cast<Address>(i * elementSize));
+            }
+        }
+    };
+    while (not pending.empty()) {
+        const auto address = pending.back();
+        pending.pop_back();
+        if (not visited.emplace(address).second) {
+            continue;
+        }
+        const auto found = pool.objectInstances.find(address);
+        if (found == pool.objectInstances.end()) {
+            // an element of a plain array
+            continue;
+        }
+        const auto& object = found->second;
+        forEachCharacterIndex(object, [&](const AptType& member) {
+            const auto index = characterIndexOf(member, used.size());
+            if (index == used.size() or used[index]) {
+                return;
+            }
+            used[index] = true;
+            if (const auto address = characterAddress(index); address != 0) {
+                pending.emplace_back(address);
+            }
+        });
+        object.forEachRecursive(visitor);
+    }
+    return used;
+}
+
+} // namespace
+
+std::filesystem::path stripApt(const std::filesystem::path& aptFileName) {
+    const auto constFileName =
+        std::filesystem::path{ aptFileName }.replace_extension(".const");
+    const auto constData = ConstFile::ConstData{ readEntireFile(constFileName) };
+    const auto entryOffset = constData.aptDataOffset;
+
+    auto full = parseApt(aptFileName, constData);
+    const auto used = findUsedCharacters(full, entryOffset);
+    const auto header = full.objectInstances.find(0);
+    const auto charactersBegin = std::get<PointerToArray>(
+        full.objectInstances.at(entryOffset).at("characters").value).pointerToArray.address;
+
+    // read the movie again with the unused elements of Movie.characters as null
+    // pointers, so that nothing of those characters is in the pool
+    auto data = std::move(full.dataSource.data);
+    auto characterCount = std::size_t{ 0 };
+    auto droppedCount = std::size_t{ 0 };
+    for (auto i = std::size_t{ 0 }; i < used.size(); ++i) {
+        const auto slot = data.begin() + charactersBegin + i * 4;
+        if (isAllZero(std::string_view{ &*slot, 4 })) {
+            continue;
+        }
+        ++characterCount;
+        if (not used[i]) {
+            std::fill_n(slot, 4, '\0');
+            ++droppedCount;
+        }
+    }
+    auto pool = AptObjectPool{};
+    pool.dataSource.reset(std::move(data));
+    loadTypeDefinitions(pool);
+    pool.sourceEndianness = constData.endianness;
+    fetchReachableObjects(pool, entryOffset, "Movie");
+    if (header != full.objectInstances.end()) {
+        pool.insertObject(header->second, 0);
+    }
+
+    const auto index = [&] {
+        try {
+            return indexPool(pool, entryOffset);
+        }
+        catch (const AptToXmlHints::SharedObjectError&) {
+            throw AptToXmlHints::sharedMovieError(aptFileName, "--strip");
+        }
+    }();
+
+    std::cout << "Dropped " << droppedCount << " of " << characterCount << " characters"
+              << std::endl;
+    const auto xmlFileName = aptFileName.string() + ".edited.xml";
+    writeXml(pool, constData, index, xmlFileName);
+    const auto strippedFileName = xmlToApt(xmlFileName);
+    std::cout << "Wrote " << strippedFileName.string() << ", "
+              << std::filesystem::file_size(strippedFileName) << " bytes instead of "
+              << std::filesystem::file_size(aptFileName) << std::endl;
+    return strippedFileName;
+}
+
+} // namespace Apt::AptEditor
@@ -0,0 +1,324 @@
+#include <algorithm>
+#include <ciso646>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "AptConstFile.hpp"
+#include "AptEditor.hpp"
+#include "ByteBuffer.hpp"
+#include "Util.hpp"
+
+// Merkle style hashes: an object is hashed from its own values with every
+// pointer replaced by the hash of what it points to, so the result does not
+// depend on where anything is stored. Each object is hashed once.
+// printDuplicates groups equal hashes to find what --dedup could share; diffApt
+// also replaces const item ids by the items, which is what the scripts push.
+namespace Apt::AptEditor {
+
+using namespace AptTypes;
+
+namespace {
+
+class SubtreeHasher {
+public:
+    SubtreeHasher(const AptObjectPool& pool, const ConstFile::ConstData* constData) :
+        pool{ pool }, constData{ constData } {}
+
+    std::uint64_t objectHash(const Address address) {
+        if (const auto known = this->hashes.objects.find(address);
+            known != this->hashes.objects.end()) {
+            return known->second;
+        }
+        // a circular reference is hashed as how far up the cycle goes
+        if (const auto onStack = std::find(this->stack.begin(), this->stack.end(), address);
+            onStack != this->stack.end()) {
+            auto buffer = ByteBuffer{};
+            buffer.append(std::uint32_t{ 0xC7C1E });
+            buffer.append(static_cast<std::uint32_t>(this->stack.end() - onStack));
+            return hashBytes(buffer.view());
+        }
+
+        this->stack.emplace_back(address);
+        const auto hash = this->valueHash(this->pool.objectInstances.at(address));
+        this->stack.pop_back();
+        this->hashes.objects.emplace(address, hash);
+        return hash;
+    }
+
+    std::uint64_t streamHash(const Address begin) {
+        if (const auto known = this->hashes.actionStreams.find(begin);
+            known != this->hashes.actionStreams.end()) {
+            return known->second;
+        }
+
+        auto buffer = ByteBuffer{};
+        const auto end = this->pool.arrays.at(begin);
+        const auto first = this->pool.objectInstances.lower_bound(begin);
+        const auto last = this->pool.objectInstances.lower_bound(end);
+        for (auto instruction = first; instruction != last; ++instruction) {
+            buffer.append(this->objectHash(instruction->first));
+        }
+        const auto hash = hashBytes(buffer.view());
+        this->hashes.actionStreams.emplace(begin, hash);
+        return hash;
+    }
+
+    SubtreeHashes hashes;
+
+private:
+    void appendConstantItem(ByteBuffer& buffer, const std::uint32_t id) const {
+        if (id >= this->constData->itemCount()) {
+            buffer.append(std::uint32_t{ 0xBAD1D });
+            buffer.append(id);
+            return;
+        }
+        buffer.append(static_cast<std::uint32_t>(this->constData->itemTypes[id]));
+        if (this->constData->itemTypes[id] == ConstFile::ConstItemType::string) {
+            const auto string = this->constData->stringAt(id);
+            buffer.appendBytes(string.data(), string.size());
+            buffer.append(std::uint8_t{ 0 });
+            return;
+        }
+        buffer.append(this->constData->itemValues[id]);
+    }
+
+    // the member of object holding const item ids, or the array of them if that
+    // member is its length (PushData); nothing without a .const
+    std::string_view constantIDMember(const AptType& object) const {
+        if (this->constData == nullptr) {
+            return {};
+        }
+        const auto* typeData = this->pool.findTypeData(object.typeName);
+        if (typeData == nullptr or not typeData->constantIDMember.has_value()) {
+            return {};
+        }
+        const auto& members = std::get<AptType::MemberArray>(object.value);
+        const auto& name = members.at(typeData->constantIDMember.value()).first;
+        for (const auto& [memberName, member] : members) {
+            if (const auto* array = std::get_if<PointerToArray>(&member.value);
+                array != nullptr and array->arraySizeVariable == name) {
+                return memberName;
+            }
+        }
+        return name;
+    }
+
+    std::uint64_t valueHash(const AptType& object) {
+        auto buffer = ByteBuffer{};
+        buffer.appendBytes(object.typeName.data(), object.typeName.size() + 1);
+
+        const auto constantIDs = this->constantIDMember(object);
+        const auto isConstantIDs = [&constantIDs](const AptType::NameStack& nameStack) {
+            return not constantIDs.empty() and nameStack.size() == 1 and
+                   nameStack.back() == constantIDs;
+        };
+        const auto visitor = [this, &buffer, &isConstantIDs](
+                                 const auto& value, const AptType::NameStack& nameStack) {
+            using Type = std::decay_t<decltype(value)>;
+            if constexpr (std::is_integral_v<Type>) {
+                if (isConstantIDs(nameStack)) {
+                    this->appendConstantItem(buffer, static_cast<std::uint32_t>(value));
+                    return;
+                }
+            }
+            if constexpr (std::is_same_v<Type, std::uint32_t>) {
+                // actions are only referenced by their offset
+                if (value != 0 and not nameStack.empty() and
+                    nameStack.back() == "actionDataOffset") {
+                    buffer.append(this->streamHash(value));
+                    return;
+                }
+                buffer.append(value);
+            }
+            else if constexpr (std::is_arithmetic_v<Type>) {
+                buffer.append(value);
+            }
+            else if constexpr (std::is_same_v<Type, Unsigned24>) {
+                buffer.append(value.value);
+            }
+            else if constexpr (std::is_same_v<Type, std::string>) {
+                buffer.appendBytes(value.data(), value.size() + 1);
+            }
+            else if constexpr (std::is_same_v<Type, AptTypePointer>) {
+                buffer.append(value.address == 0 ? std::uint64_t{ 0 }
+                                                 : this->objectHash(value.address));
+            }
+            else if constexpr (std::is_same_v<Type, PointerToArray>) {
+                buffer.append(static_cast<std::uint64_t>(value.length));
+                const auto& pointer = value.pointerToArray;
+                const auto elementSize = this->pool.getType(pointer.typePointedTo).size();
+                for (auto i = std::size_t{ 0 }; i < value.length; ++i) {
+                    const auto element = pointer.address + static_cast<Address>(i * elementSize);
+                    if (isConstantIDs(nameStack)) {
+                        const AptType& id = this->pool.objectInstances.at(element);
+                        this->appendConstantItem(buffer, id.getNumericValue<std::uint32_t>());
+                        continue;
+                    }
+                    buffer.append(this->objectHash(element));
+                }
+            }
+            // paddings only depend on where the object is
+        };
+        object.forEachRecursive(visitor);
+        return hashBytes(buffer.view());
+    }
+
+    const AptObjectPool& pool;
+    const ConstFile::ConstData* constData;
+    std::vector<Address> stack;
+};
+
+} // namespace
+
+SubtreeHashes hashSubtrees(const AptObjectPool& pool,
+                           const Address entryOffset,
+                           const ConstFile::ConstData* constData) {
+    auto hasher = SubtreeHasher{ pool, constData };
+    hasher.objectHash(entryOffset);
+    return std::move(hasher.hashes);
+}
+
+void printDuplicates(const std::filesystem::path& aptFileName) {
+    const auto constFileName =
+        std::filesystem::path{ aptFileName }.replace_extension(".const");
+    const auto constData = ConstFile::ConstData{ readEntireFile(constFileName) };
+    const auto pool = parseApt(aptFileName, constData);
+    const auto hashes = hashSubtrees(pool, constData.aptDataOffset);
+
+    // bytes of the objects and everything they point to
+    const auto subtreeSize = [&pool](std::vector<Address> pending) {
+        auto size = std::size_t{ 0 };
+        auto visited = std::set<Address>{};
+        const auto visitor = [&pool, &pending](const auto& value, const AptType::NameStack&) {
+            using Type = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<Type, AptTypePointer>) {
+                if (value.address != 0) {
+                    pending.emplace_back(value.address);
+                }
+            }
+            else if constexpr (std::is_same_v<Type, PointerToArray>) {
+                const auto& pointer = value.pointerToArray;
+                const auto elementSize = pool.getType(pointer.typePointedTo).size();
+                for (auto i = std::size_t{ 0 }; i < value.length; ++i) {
+                    pending.emplace_back(pointer.address + static_cast<Address>(i * elementSize));
+                }
+            }
+        };
+        while (not pending.empty()) {
+            const auto address = pending.back();
+            pending.pop_back();
+            if (not visited.emplace(address).second) {
+                continue;
+            }
+            const auto& object = pool.objectInstances.at(address);
+            size += object.size();
+            object.forEachRecursive(visitor);
+            if (const auto actions = object.find("actionDataOffset"); actions.has_value()) {
+                const auto begin = object.at(actions.value()).getNumericValue<Address>();
+                if (const auto stream = pool.arrays.find(begin); stream != pool.arrays.end()) {
+                    size += stream->second - begin;
+                }
+            }
+        }
+        return size;
+    };
+
+    struct Group {
+        std::string what;
+        std::vector<Address> roots;
+        std::size_t count;
+        std::size_t size;
+    };
+    // only what the writer can share: pointed objects, whole arrays and action streams
+    auto groups = std::map<std::pair<std::string, std::uint64_t>, Group>{};
+    auto counted = std::set<std::pair<std::string, Address>>{};
+    const auto count = [&groups, &counted](const std::string& what,
+                                           const std::uint64_t hash,
+                                           const Address address,
+                                           std::vector<Address> roots) {
+        if (not counted.emplace(what, address).second) {
+            // already shared in this file
+            return;
+        }
+        const auto [group, inserted] =
+            groups.try_emplace(std::pair{ what, hash }, Group{ what, std::move(roots), 0, 0 });
+        group->second.count += 1;
+    };
+    const auto visitor = [&pool, &hashes, &count](const auto& value, const AptType::NameStack&) {
+        using Type = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<Type, AptTypePointer>) {
+            if (const auto hash = hashes.objects.find(value.address);
+                hash != hashes.objects.end()) {
+                const auto& target = pool.objectInstances.at(value.address);
+                count(target.typeName, hash->second, value.address, { value.address });
+            }
+        }
+        else if constexpr (std::is_same_v<Type, PointerToArray>) {
+            const auto& pointer = value.pointerToArray;
+            if (value.length == 0 or hashes.objects.count(pointer.address) == 0) {
+                return;
+            }
+            const auto elementSize = pool.getType(pointer.typePointedTo).size();
+            auto elements = std::vector<Address>{};
+            auto buffer = ByteBuffer{};
+            for (auto i = std::size_t{ 0 }; i < value.length; ++i) {
+                elements.emplace_back(pointer.address + static_cast<Address>(i * elementSize));
+                buffer.append(hashes.objects.at(elements.back()));
+            }
+            count("array of " + pointer.typePointedTo, hashBytes(buffer.view()), pointer.address,
+                  std::move(elements));
+        }
+    };
+    for (const auto& [address, hash] : hashes.objects) {
+        pool.objectInstances.at(address).forEachRecursive(visitor);
+    }
+    for (const auto& [begin, hash] : hashes.actionStreams) {
+        count("action stream", hash, begin, { begin });
+        groups.at(std::pair{ std::string{ "action stream" }, hash }).size =
+            pool.arrays.at(begin) - begin;
+    }
+
+    auto duplicated = std::vector<Group>{};
+    for (auto& [key, group] : groups) {
+        if (group.count < 2) {
+            continue;
+        }
+        if (group.size == 0) {
+            group.size = subtreeSize(group.roots);
+        }
+        duplicated.emplace_back(group);
+    }
+    const auto saving = [](const Group& group) { return (group.count - 1) * group.size; };
+    std::sort(duplicated.begin(), duplicated.end(), [&saving](const Group& a, const Group& b) {
+        return saving(a) > saving(b);
+    });
+
+    constexpr auto shown = std::size_t{ 20 };
+    std::cout << duplicated.size() << " duplicated subtrees";
+    if (duplicated.size() > shown) {
+        std::cout << ", the largest " << shown << ':';
+    }
+    std::cout << std::endl;
+    for (auto i = std::size_t{ 0 }; i < (std::min)(shown, duplicated.size()); ++i) {
+        const auto& group = duplicated[i];
+        std::cout << group.count << " x " << group.what << " (first at " << group.roots.front()
+                  << "), " << group.size << " bytes each, about " << saving(group)
+                  << " bytes could be shared" << std::endl;
+    }
+    if (duplicated.empty()) {
+        return;
+    }
+    // a duplicated subtree usually contains duplicated subtrees too
+    std::cout << "Nested duplicates overlap, the savings do not add up; convert the .xml with "
+                 "--dedup to share them"
+              << std::endl;
+}
+
+} // namespace Apt::AptEditor
@@ -1,13 +1,21 @@
+#include <algorithm>
+#include <array>
 #include <cctype>
+#include <charconv>
 #include <ciso646>
+#include <fstream>
 #include <map>
+#include <optional>
+#include <set>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <variant>
 #include <vector>
 #include <iostream>
+#include <limits>
 
+#include "ActionFlowGraph.hpp"
 #include "AptConstFile.hpp"
 #include "AptEditor.hpp"
 #include "AptTypeDefinitionsParser.hpp"
@@ -21,11 +29,106 @@ namespace FileSystem = std::filesystem;
 namespace Apt::AptEditor {
 
 using namespace AptTypes;
+using AptToXmlHints::setNumberAttribute;
 
 const char* chooseAttributeName(const std::string& name) {
     return name.empty() ? "value" : name.c_str();
 }
 
+// prints the same layout as tinyxml2::XMLPrinter, which formats each piece
+// with vsnprintf and escapes attributes one character at a time
+class XmlStringPrinter : public tinyxml2::XMLVisitor {
+public:
+    XmlStringPrinter() = default;
+    // goes on with a document printed elsewhere up to depth open elements
+    explicit XmlStringPrinter(const std::size_t depth) : depth{ depth }, firstLine{ false } {}
+
+    bool VisitEnter(const tinyxml2::XMLElement& element,
+                    const tinyxml2::XMLAttribute* attribute) override {
+        this->beginLine();
+        this->output += '<';
+        this->output += element.Name();
+        for (; attribute != nullptr; attribute = attribute->Next()) {
+            this->output += ' ';
+            this->output += attribute->Name();
+            this->output += "=\"";
+            appendXmlEscaped(this->output, attribute->Value());
+            this->output += '"';
+        }
+        this->elementJustOpened = true;
+        ++this->depth;
+        return true;
+    }
+
+    bool VisitExit(const tinyxml2::XMLElement& element) override {
+        --this->depth;
+        if (this->elementJustOpened) {
+            this->output += "/>";
+        }
+        else {
+            this->output += '\n';
+            this->output.append(this->depth * 4, ' ');
+            this->output += "</";
+            this->output += element.Name();
+            this->output += '>';
+        }
+        if (this->depth == 0) {
+            this->output += '\n';
+        }
+        this->elementJustOpened = false;
+        return true;
+    }
+
+    bool Visit(const tinyxml2::XMLComment& comment) override {
+        this->beginLine();
+        this->output += "<!--";
+        this->output += comment.Value();
+        this->output += "-->";
+        return true;
+    }
+
+    bool Visit(const tinyxml2::XMLDeclaration& declaration) override {
+        this->beginLine();
+        this->output += "<?";
+        this->output += declaration.Value();
+        this->output += "?>";
+        return true;
+    }
+
+    bool Visit(const tinyxml2::XMLText&) override {
+        throw std::logic_error{ "Text nodes are never written" };
+    }
+
+    bool Visit(const tinyxml2::XMLUnknown&) override {
+        throw std::logic_error{ "Unknown nodes are never written" };
+    }
+
+    // moves what was printed so far to stream
+    void flushTo(std::ostream& stream) {
+        stream << this->output;
+        this->output.clear();
+    }
+
+    std::string output;
+
+private:
+    void beginLine() {
+        if (this->elementJustOpened) {
+            this->output += '>';
+            this->elementJustOpened = false;
+        }
+        if (not this->firstLine) {
+            this->output += '\n';
+        }
+        this->firstLine = false;
+        this->output.append(this->depth * 4, ' ');
+    }
+
+    std::size_t depth = 0;
+    bool firstLine = true;
+    bool elementJustOpened = false;
+};
+
 bool isRef(const AptType& object) {
     return std::holds_alternative<AptTypePointer>(object.value) or
            std::holds_alternative<PointerToArray>(object.value);
@@ -37,8 +140,7 @@ void writeObject(tinyxml2::XMLElement* node, const AptObjectPool& pool,
 template <typename T>
 void writeNode(tinyxml2::XMLElement* node, const AptObjectPool& pool,
                const std::string& name, const T& value) {
-    static_assert(std::is_arithmetic_v<T>);
-    node->SetAttribute(chooseAttributeName(name), +value);
+    setNumberAttribute(node, chooseAttributeName(name), +value);
 }
 
 void writeNode(tinyxml2::XMLElement* node, const AptObjectPool& pool,
@@ -131,10 +233,7 @@ void writeObject(tinyxml2::XMLElement* node, const AptObjectPool& pool,
     }
 }
 
-using DestinationMap = std::map<Address, std::pair<Address, std::string>>;
-
-void readInstructions(AptObjectPool& pool, const Address startAddress,
-                      DestinationMap& outputDestinationMap) {
+void readInstructions(AptObjectPool& pool, const Address startAddress) {
 
     auto lastInstructionIsEnd = false;
 
@@ -148,30 +247,19 @@ void readInstructions(AptObjectPool& pool, const Address startAddress,
         auto currentInstruction = pool.constructObject(instructionPrototype, reader);
         const auto instructionType = std::string_view{ currentInstruction.typeName };
 
-        const auto setDestination = [&outputDestinationMap,
-                                     currentAddress,
-                                     &canEndAfterHere,
-                                     instructionType](const Address destination) {
-            auto destinationInformation =
-                std::pair{ destination,
-                           asString(instructionType, "@", currentAddress) };
-            outputDestinationMap.emplace(currentAddress,
-                                         std::move(destinationInformation));
-            canEndAfterHere = (std::max)(canEndAfterHere, destination);
-        };
-
         if (instructionType.find("Branch") == 0) {
             const auto offset =
                 currentInstruction.at("offset").getNumericValue<std::int32_t>();
-            const auto jumpLocation = reader.absolutePosition() + offset;
-            setDestination(jumpLocation);
+            const auto jumpLocation = static_cast<Address>(reader.absolutePosition() + offset);
+            canEndAfterHere = (std::max)(canEndAfterHere, jumpLocation);
         }
 
         if (instructionType.find("DefineFunction") == 0) {
             const auto functionSize =
                 currentInstruction.at("size").getNumericValue<std::uint32_t>();
-            const auto endOfFunction = reader.absolutePosition() + functionSize;
-            setDestination(endOfFunction);
+            const auto endOfFunction =
+                static_cast<Address>(reader.absolutePosition() + functionSize);
+            canEndAfterHere = (std::max)(canEndAfterHere, endOfFunction);
         }
 
         lastInstructionIsEnd = instructionType == "End";
@@ -183,143 +271,222 @@ void readInstructions(AptObjectPool& pool, const Address startAddress,
     pool.insertArrayData(startAddress, reader.absolutePosition());
 }
 
+DestinationMap getDestinationMap(const AptObjectPool& pool) {
+    auto destinationMap = DestinationMap{};
+    for (const auto& [address, instruction] : pool.objectInstances) {
+        if (instruction.baseTypeName != "Instruction") {
+            continue;
+        }
+        const auto instructionType = std::string_view{ instruction.typeName };
+        const auto nextInstruction = static_cast<Address>(address + instruction.size());
+        const auto setDestination = [&](const Address destination) {
+            destinationMap.emplace(
+                address,
+                std::pair{ destination, asString(instructionType, "@", address) });
+        };
 
+        if (instructionType.find("Branch") == 0) {
+            const auto offset = instruction.at("offset").getNumericValue<std::int32_t>();
+            setDestination(nextInstruction + offset);
+        }
 
-void aptToXml(const std::filesystem::path& aptFileName) {
-    const auto constFileName =
-        std::filesystem::path{ aptFileName }.replace_extension(".const");
-    const auto constData = ConstFile::ConstData(readEntireFile(constFileName));
-    const auto entryOffset = constData.aptDataOffset;
+        if (instructionType.find("DefineFunction") == 0) {
+            // end of function will be the start address of last instruction in function
+            // body (instead of end address)
+            const auto functionSize =
+                instruction.at("size").getNumericValue<std::uint32_t>();
+            const auto current =
+                pool.objectInstances.lower_bound(nextInstruction + functionSize);
+            if (current == pool.objectInstances.begin()) {
+                throw std::runtime_error{ "wrong definefunction body size? " };
+            }
+            setDestination(std::prev(current)->first);
+        }
+    }
+    return destinationMap;
+}
 
-    // auto data = AptFile::AptData{AptFile::DataSource{readEntireFile(aptFileName)}};
-    const auto preprocess = [](const auto& fileName) {
-        std::string definitionFile = readEntireFile(fileName);
-        while (definitionFile.find("/*") != definitionFile.npos) {
-            const auto begin = definitionFile.find("/*");
-            const auto end = definitionFile.find("*/", begin + 2) + 2;
-            definitionFile.erase(begin, (end - begin));
+std::string encodeHeaderData(const std::string_view data) {
+    auto headerData = std::string{};
+    // the longest possible result, every byte escaped
+    headerData.reserve(data.size() * 4);
+    for (const auto byte : data) {
+        if (std::isprint(static_cast<unsigned char>(byte))) {
+            headerData.push_back(byte);
+            continue;
         }
-        return definitionFile;
-    };
 
-    auto pool = AptObjectPool{};
-    pool.dataSource.reset(readEntireFile(aptFileName));
-    Parser::readTypeDefinitions(preprocess("AptTypeDefinitions.txt"), pool);
+        headerData += "\\x";
+        appendHexByte(headerData, static_cast<std::uint8_t>(byte));
+    }
+    return headerData;
+}
 
-    {
-        auto reader = pool.getReaderAtOffset(entryOffset);
-        pool.insertObject(pool.constructObject(pool.getType("Movie"), reader),
-                          entryOffset);
+void loadTypeDefinitions(AptObjectPool& pool) {
+    // the definition files are parsed once per process, every pool gets a copy
+    static const auto definitions = [] {
+        auto definitionPool = AptObjectPool{};
+        Parser::readTypeDefinitionFile("AptTypeDefinitions.txt", definitionPool);
+        Parser::readTypeDefinitionFile("ActionTypeDeclarations.txt", definitionPool);
+        Parser::readTypeDefinitionFile("ActionTypeDefinitions.txt", definitionPool);
+        return std::move(definitionPool.types);
+    }();
+    pool.types = definitions;
+}
+
+void fetchReachableObjects(AptObjectPool& pool,
+                           const Address root,
+                           const std::string_view rootType) {
+    pool.fetchPointedObjects(pool.getObject(root, rootType));
 
-        pool.fetchPointedObjects(pool.objectInstances.at(entryOffset));
+    // fetch instructions
+    auto actionDataOffsets = std::vector<Address>{};
+    for (const auto& [address, object] : pool.objectInstances) {
+        const auto actionOffsetIndex = object.find("actionDataOffset");
+        if (not actionOffsetIndex.has_value()) {
+            continue;
+        }
+
+        const auto actionOffset =
+            std::get<Address>(object.at(actionOffsetIndex.value()).value);
+        actionDataOffsets.emplace_back(actionOffset);
     }
 
-    auto destinationMap = DestinationMap{};
-    {
-        // fetch instructions
-        Parser::readTypeDefinitions(preprocess("ActionTypeDeclarations.txt"), pool);
-        Parser::readTypeDefinitions(preprocess("ActionTypeDefinitions.txt"), pool);
-        auto actionDataOffsets = std::vector<Address>{};
-        for (const auto& [address, object] : pool.objectInstances) {
-            const auto actionOffsetIndex = object.find("actionDataOffset");
-            if (not actionOffsetIndex.has_value()) {
-                continue;
-            }
+    // deduplicated .apt files may share action streams
+    std::sort(actionDataOffsets.begin(), actionDataOffsets.end());
+    actionDataOffsets.erase(std::unique(actionDataOffsets.begin(), actionDataOffsets.end()),
+                            actionDataOffsets.end());
+    for (const auto actionDataOffset : actionDataOffsets) {
+        readInstructions(pool, actionDataOffset);
+    }
+}
 
-            const auto actionOffset =
-                std::get<Address>(object.at(actionOffsetIndex.value()).value);
-            actionDataOffsets.emplace_back(actionOffset);
+// the unparsed bytes at the beginning are the header, returned as AptHeaderData;
+// any other data which was not read must be zeros
+std::optional<AptType> checkUnparsedData(const DataSource& dataSource) {
+    auto header = std::optional<AptType>{};
+    for (const auto [begin, end] : dataSource.unparsedBeginEnd) {
+        const auto length = end - begin;
+        if (length == 0) {
+            // zero-length unparsed data
+            continue;
         }
 
-        for (const auto actionDataOffset : actionDataOffsets) {
-            readInstructions(pool, actionDataOffset, destinationMap);
+        const auto data = dataSource.bytes().substr(begin, length);
+
+        if (begin == 0) {
+            header = AptType{ "AptHeaderData", "AptHeaderData", encodeHeaderData(data), length };
+            continue;
         }
 
-        // edit destinationMap so end of function will match the start address of last
-        // instruction in function body (instead of end address)
-        for (auto& [address, destinationInformation] : destinationMap) {
-            auto& [destination, information] = destinationInformation;
-            if (information.find("DefineFunction") == 0) {
-                const auto current = pool.objectInstances.lower_bound(destination);
-                if (current == pool.objectInstances.begin()) {
-                    throw std::runtime_error{ "wrong definefunction body size? " };
-                }
-                destination = std::prev(current)->first;
-            }
+        if (not isAllZero(data)) {
+            throw std::runtime_error{ "Non null unparsed data!!!!!" };
         }
     }
+    return header;
+}
+
+AptObjectPool parseApt(const std::filesystem::path& aptFileName,
+                       const ConstFile::ConstData& constData,
+                       const bool plainArraysAsSpans) {
+    auto pool = AptObjectPool{};
+    pool.dataSource.reset(readEntireFile(aptFileName));
+    loadTypeDefinitions(pool);
+    pool.plainArraysAsSpans = plainArraysAsSpans;
+    pool.sourceEndianness = constData.endianness;
+
+    fetchReachableObjects(pool, constData.aptDataOffset, "Movie");
+
+    if (auto header = checkUnparsedData(pool.dataSource); header.has_value()) {
+        pool.insertObject(std::move(header.value()), 0);
+    }
+
+    return pool;
+}
+
+PoolIndex indexPool(const AptObjectPool& pool, const Address entryOffset) {
+    auto index = PoolIndex{};
+    index.destinationMap = getDestinationMap(pool);
 
     // merge jumpMap
-    auto references =
-        AptToXmlHints::getReferenceDescriptions(pool, entryOffset);
-    for (const auto& [source, destination] : destinationMap) {
+    index.references = AptToXmlHints::getReferenceDescriptions(pool, entryOffset);
+    for (const auto& [source, destination] : index.destinationMap) {
         const auto& [destinationAddress, description] = destination;
-        references[destinationAddress] += 1;
+        index.references[destinationAddress] += 1;
     }
 
+    index.parentMap = AptToXmlHints::getParentMap(pool, entryOffset);
+    return index;
+}
+
+void writeXml(const AptObjectPool& pool,
+              const ConstFile::ConstData& constData,
+              const PoolIndex& index,
+              const std::filesystem::path& xmlFileName) {
+    writeXml(pool, constData, index, constData.aptDataOffset, xmlFileName);
+}
+
+// fills xml with the declaration and ParsedAptData, nested like the movie
+void buildXml(tinyxml2::XMLDocument& xml,
+              const AptObjectPool& pool,
+              const ConstFile::ConstData& constData,
+              const PoolIndex& index,
+              const Address entryOffset) {
+    // a pool without header only holds what is reachable from one character
+    const auto isPartial = pool.objectInstances.count(0) == 0;
+    const auto& destinationMap = index.destinationMap;
+    auto references = index.references;
+
     auto endOfFunctions = std::map<Address, std::string>{};
+    // instructions which are jumped to need their address for xmlToApt
+    auto branchDestinations = std::set<Address>{};
     for (const auto& [source, destination] : destinationMap) {
         const auto& [destinationAddress, description] = destination;
         if(description.find("DefineFunction") == 0) {
             endOfFunctions.emplace(destination);
         }
+        branchDestinations.emplace(destinationAddress);
     }
 
-    // check unparsed data
-    {
-        const auto& unparsed = pool.dataSource.unparsedBeginEnd;
-        for (const auto [begin, end] : unparsed) {
-            const auto length = end - begin;
-            if (length == 0) {
-                // zero-length unparsed data
-                continue;
-            }
-
-            const auto data =
-                std::string_view{ pool.dataSource.data }.substr(begin, length);
-
-            if (begin == 0) {
-                // header
-
-                auto headerData = std::ostringstream{};
-                for (const auto byte : data) {
-                    if (std::isprint(byte)) {
-                        headerData << byte;
-                        continue;
-                    }
-
-                    headerData << "\\x";
-                    headerData << std::hex << std::uppercase << std::setfill('0')
-                               << std::setw(2) << +static_cast<std::uint8_t>(byte);
-                }
-
-                const auto unparsedChunk = AptType{
-                    "AptHeaderData", "AptHeaderData", headerData.str(), length
-                };
-
-                pool.insertObject(unparsedChunk, begin);
-                continue;
-            }
-
-            for (const auto byte : data) {
-                if (byte != 0) {
-                    throw std::runtime_error{ "Non null unparsed data!!!!!" };
-                }
+    // instructions no path from the start of their stream gets to, the first of each run
+    auto unreachable = std::set<Address>{};
+    for (const auto& [begin, pastTheEnd] : pool.arrays) {
+        const auto first = pool.objectInstances.find(begin);
+        if (first == pool.objectInstances.end() or
+            first->second.baseTypeName != "Instruction") {
+            continue;
+        }
+        auto graph = ActionFlow::FlowGraph{};
+        try {
+            graph = ActionFlow::buildFlowGraph(pool, begin);
+        }
+        catch (const std::runtime_error&) {
+            // a branch or function body which does not end at an instruction: the
+            // stream is written as before, only without this hint
+            continue;
+        }
+        auto previousReachable = true;
+        for (const auto& block : graph.blocks) {
+            if (not block.reachable and previousReachable) {
+                unreachable.emplace(graph.addressOf(block));
             }
+            previousReachable = block.reachable;
         }
     }
 
-    auto xml = tinyxml2::XMLDocument{};
     auto topLevelNodeMap = std::map<Address, tinyxml2::XMLElement*>{};
     auto nodeMap = std::map<Address, tinyxml2::XMLElement*>{};
 
     xml.InsertFirstChild(xml.NewDeclaration());
     auto* aptDataNode = xml.NewElement("ParsedAptData");
     xml.InsertEndChild(aptDataNode);
+    if (isPartial) {
+        setNumberAttribute(aptDataNode, "rootAddress", entryOffset);
+    }
     auto* parent = aptDataNode;
     auto arrayEnd = Address{ 0 };
     auto arrayIndex = 0;
-    for (const auto& [address, object] : pool.objectInstances) {
+    const auto writeObjectNode = [&](const Address address, const AptType& object) {
         const auto referencesBegin = references.begin();
         const auto referencesBound = references.upper_bound(address);
         const auto referenced = (referencesBegin != referencesBound);
@@ -343,9 +510,12 @@ void aptToXml(const std::filesystem::path& aptFileName) {
             arrayIndex = 0;
         }
 
+        if (unreachable.count(address) > 0) {
+            AptToXmlHints::appendXmlComment(parent, "Unreachable");
+        }
         if (object.baseTypeName == "Instruction") {
             const auto constantHint =
-                AptToXmlHints::hintForConstantID(constData, object);
+                AptToXmlHints::hintForConstantID(pool, constData, object);
             if (not constantHint.empty()) {
                 AptToXmlHints::appendXmlComment(parent, constantHint);
             }
@@ -369,7 +539,7 @@ void aptToXml(const std::filesystem::path& aptFileName) {
                 if (pool.arrays.count(address) > 0) {
                     topLevelNodeMap.emplace(address, parent);
                 }
-                node->SetAttribute("arrayIndex", arrayIndex);
+                setNumberAttribute(node, "arrayIndex", arrayIndex);
                 arrayIndex += 1;
             }
             // if it's not entryPoint...
@@ -380,8 +550,12 @@ void aptToXml(const std::filesystem::path& aptFileName) {
         }
 
         // special handling for entryPoint
-        if(address == entryOffset) {
-            aptDataNode->InsertAfterChild(aptDataNode->FirstChildElement(), node);
+        if(address == entryOffset and not isPartial) {
+            // tinyxml2 cannot move a node to where it already is
+            auto* header = aptDataNode->FirstChildElement();
+            if(header->NextSibling() != node) {
+                aptDataNode->InsertAfterChild(header, node);
+            }
         }
         
         writeObject(node, pool, {}, object);
@@ -391,14 +565,17 @@ void aptToXml(const std::filesystem::path& aptFileName) {
                 AptToXmlHints::appendXmlComment(parent, "End Of Function");
             }
 
+            if (branchDestinations.count(address)) {
+                setNumberAttribute(node, "address", address);
+            }
+
             if (object.typeName.find("Branch") == 0) {
                 node->DeleteAttribute("offset");
-                node->SetAttribute("destinationAddress",
-                                   destinationMap.at(address).first);
+                setNumberAttribute(node, "destinationAddress", destinationMap.at(address).first);
             }
             if (object.typeName.find("DefineFunction") == 0) {
                 node->DeleteAttribute("size");
-                node->SetAttribute("lastInstructionStartAddress",
+                setNumberAttribute(node, "lastInstructionStartAddress",
                                    destinationMap.at(address).first);
             }
         }
@@ -407,9 +584,27 @@ void aptToXml(const std::filesystem::path& aptFileName) {
             parent = aptDataNode;
             arrayEnd = 0; // reset array end
         }
+    };
+    // elements of plain data arrays are decoded one at a time, in address order
+    // with the objects
+    auto plainArray = pool.plainArrays.begin();
+    const auto writePlainArraysBefore = [&](const Address address) {
+        for (; plainArray != pool.plainArrays.end() and plainArray->first < address;
+             ++plainArray) {
+            const auto& [begin, array] = *plainArray;
+            const auto elementSize = array.elementType.size();
+            for (auto i = std::size_t{ 0 }; i < array.length; ++i) {
+                writeObjectNode(begin + static_cast<Address>(i * elementSize), array.element(i));
+            }
+        }
+    };
+    for (const auto& [address, object] : pool.objectInstances) {
+        writePlainArraysBefore(address);
+        writeObjectNode(address, object);
     }
+    writePlainArraysBefore((std::numeric_limits<Address>::max)());
 
-    auto parentMap = AptToXmlHints::getParentMap(pool, entryOffset);
+    const auto& parentMap = index.parentMap;
     for (const auto& [address, node] : topLevelNodeMap) {
         if(address == entryOffset) {
             continue;
@@ -499,13 +694,208 @@ void aptToXml(const std::filesystem::path& aptFileName) {
         placeHolderNode->InsertEndChild(deadRefElement);
     }
     aptDataNode->DeleteChild(placeHolderNode);
+}
 
-    tinyxml2::XMLPrinter printer;
+void writeXml(const AptObjectPool& pool,
+              const ConstFile::ConstData& constData,
+              const PoolIndex& index,
+              const Address entryOffset,
+              const std::filesystem::path& xmlFileName) {
+    auto xml = tinyxml2::XMLDocument{};
+    buildXml(xml, pool, constData, index, entryOffset);
+    auto printer = XmlStringPrinter{};
     xml.Accept(&printer);
-    const auto xmlString = std::string{ printer.CStr() };
-    auto xmlOutput = std::ofstream{ aptFileName.string() + ".edited.xml" };
-    xmlOutput << xmlString << std::endl;
+    auto xmlOutput = std::ofstream{ xmlFileName };
+    xmlOutput << printer.output << std::endl;
+}
 
-    return;
+void aptToXml(const std::filesystem::path& aptFileName, const bool useCache) {
+    const auto parsed = openApt(aptFileName, useCache);
+    writeXml(parsed.pool,
+             parsed.constData,
+             parsed.index,
+             aptFileName.string() + ".edited.xml");
+}
+
+// rough cost of an object while it is converted: the AptType, its xml node with
+// the attributes and its printed line
+constexpr auto streamedBytesPerObject = std::size_t{ 1024 };
+// a node of DataSource::unparsedBeginEnd, which is kept for the whole conversion
+constexpr auto bytesPerUnparsedRange = std::size_t{ 64 };
+
+// the .apt itself is mapped, its pages are not counted: they are only read when
+// touched and can be dropped by the system again
+void checkWorkingSet(const AptObjectPool& pool,
+                     const std::size_t memoryLimit,
+                     const std::string_view what) {
+    auto objectCount = pool.objectInstances.size();
+    for (const auto& [begin, array] : pool.plainArrays) {
+        objectCount += array.length;
+    }
+    const auto estimate = objectCount * streamedBytesPerObject +
+                          pool.dataSource.unparsedBeginEnd.size() * bytesPerUnparsedRange;
+    if (estimate > memoryLimit) {
+        const auto megabyte = std::size_t{ 1 } << 20;
+        throw std::runtime_error{ asString(what, " needs about ",
+                                           (estimate + megabyte - 1) / megabyte,
+                                           " MB, more than the limit of ",
+                                           memoryLimit / megabyte, " MB") };
+    }
+}
+
+// prints the movie, and when its characters array is closed, converts and prints
+// one character after another, each from an emptied pool
+class StreamingXmlPrinter : public XmlStringPrinter {
+public:
+    StreamingXmlPrinter(AptObjectPool& pool,
+                        const ConstFile::ConstData& constData,
+                        const std::size_t memoryLimit,
+                        const tinyxml2::XMLElement* characterArray,
+                        const std::map<Address, std::size_t>& characters,
+                        std::ostream& sink) :
+        XmlStringPrinter{ 1 },
+        pool{ pool },
+        constData{ constData },
+        memoryLimit{ memoryLimit },
+        characterArray{ characterArray },
+        characters{ characters },
+        sink{ sink } {}
+
+    bool VisitExit(const tinyxml2::XMLElement& element) override {
+        if (&element == this->characterArray) {
+            // in address order, like aptToXml moves them out of their Ref
+            for (const auto& [address, index] : this->characters) {
+                this->printCharacter(address, index);
+            }
+        }
+        return XmlStringPrinter::VisitExit(element);
+    }
+
+private:
+    void printCharacter(const Address address, const std::size_t index) {
+        this->pool.objectInstances.clear();
+        this->pool.arrays.clear();
+        this->pool.plainArrays.clear();
+        fetchReachableObjects(this->pool, address, "Character");
+        checkWorkingSet(this->pool, this->memoryLimit, asString("Character ", index));
+
+        auto xml = tinyxml2::XMLDocument{};
+        buildXml(xml, this->pool, this->constData, indexPool(this->pool, address), address);
+        auto* character = xml.RootElement()->FirstChildElement();
+        setNumberAttribute(character, "arrayIndex", index);
+        character->Accept(this);
+        this->flushTo(this->sink);
+    }
+
+    AptObjectPool& pool;
+    const ConstFile::ConstData& constData;
+    std::size_t memoryLimit;
+    const tinyxml2::XMLElement* characterArray;
+    const std::map<Address, std::size_t>& characters;
+    std::ostream& sink;
+};
+
+void aptToXmlStreaming(const std::filesystem::path& aptFileName, const std::size_t memoryLimit) {
+    const auto constFileName =
+        std::filesystem::path{ aptFileName }.replace_extension(".const");
+    const auto constData = ConstFile::ConstData{ readEntireFile(constFileName) };
+    const auto entryOffset = constData.aptDataOffset;
+    auto pool = openLazyPool(aptFileName, constData, true);
+    pool.plainArraysAsSpans = true;
+
+    // the movie is converted first without its characters: the pointers to them
+    // are read and set to null before anything else is fetched
+    auto characters = std::map<Address, std::size_t>{};
+    const auto& movie = pool.getObject(entryOffset, "Movie");
+    const auto& characterPointers = std::get<PointerToArray>(movie.at("characters").value);
+    const auto& firstPointer = characterPointers.pointerToArray;
+    const auto pointerSize = pool.getType(firstPointer.typePointedTo).size();
+    for (auto i = std::size_t{ 0 }; i < characterPointers.length; ++i) {
+        const auto elementAddress = firstPointer.address + static_cast<Address>(i * pointerSize);
+        pool.arrayElement(characterPointers, i);
+        auto& pointer =
+            std::get<AptTypePointer>(pool.objectInstances.at(elementAddress).value);
+        if (pointer.address == 0 or pointer.address == entryOffset) {
+            continue;
+        }
+        if (not characters.emplace(pointer.address, i).second) {
+            throw std::runtime_error{ "Character " + std::to_string(i) +
+                                      " is shared with another one, shared objects "
+                                      "cannot be converted to xml" };
+        }
+        pointer.address = 0;
+    }
+    fetchReachableObjects(pool, entryOffset, "Movie");
+    checkWorkingSet(pool, memoryLimit, "The movie without its characters");
+
+    auto xml = tinyxml2::XMLDocument{};
+    buildXml(xml, pool, constData, indexPool(pool, entryOffset), entryOffset);
+    auto* movieNode = xml.RootElement()->FirstChildElement();
+    tinyxml2::XMLElement* characterArray = nullptr;
+    for (auto* child = movieNode->FirstChildElement("Array"); child != nullptr;
+         child = child->NextSiblingElement("Array")) {
+        if (child->Attribute("name", "characters") != nullptr) {
+            characterArray = child;
+        }
+    }
+    if (characterArray != nullptr) {
+        // the null Refs which stand for the characters
+        auto indices = std::set<std::size_t>{};
+        for (const auto& [address, index] : characters) {
+            indices.emplace(index);
+        }
+        for (auto* child = characterArray->FirstChildElement(); child != nullptr;) {
+            auto* next = child->NextSiblingElement();
+            if (indices.count(child->UnsignedAttribute("arrayIndex")) > 0) {
+                characterArray->DeleteChild(child);
+            }
+            child = next;
+        }
+    }
+
+    // the header is what is left unread at the beginning, so it is only known at
+    // the end; the body is kept in a temporary file until then
+    const auto xmlFileName = aptFileName.string() + ".edited.xml";
+    const auto bodyFileName = xmlFileName + ".part";
+    auto header = std::optional<AptType>{};
+    try {
+        auto body = std::ofstream{ bodyFileName };
+        auto printer =
+            StreamingXmlPrinter{ pool, constData, memoryLimit, characterArray, characters, body };
+        movieNode->Accept(&printer);
+        printer.VisitExit(*xml.RootElement());
+        printer.flushTo(body);
+        if (not body) {
+            throw std::runtime_error{ "Cannot write to " + bodyFileName };
+        }
+        header = checkUnparsedData(pool.dataSource);
+        if (not header.has_value()) {
+            throw std::runtime_error{ "Cannot find the header of " + aptFileName.string() };
+        }
+    }
+    catch (...) {
+        std::filesystem::remove(bodyFileName);
+        throw;
+    }
+
+    auto head = tinyxml2::XMLDocument{};
+    head.InsertFirstChild(head.NewDeclaration());
+    auto* aptDataNode = head.NewElement("ParsedAptData");
+    head.InsertEndChild(aptDataNode);
+    auto* headerNode = head.NewElement("AptHeaderData");
+    aptDataNode->InsertEndChild(headerNode);
+    writeObject(headerNode, pool, {}, header.value());
+    auto printer = XmlStringPrinter{};
+    head.FirstChild()->Accept(&printer);
+    printer.VisitEnter(*aptDataNode, nullptr);
+    headerNode->Accept(&printer);
+
+    auto xmlOutput = std::ofstream{ xmlFileName };
+    printer.flushTo(xmlOutput);
+    {
+        auto body = std::ifstream{ bodyFileName };
+        xmlOutput << body.rdbuf() << std::endl;
+    }
+    std::filesystem::remove(bodyFileName);
 }
 } // namespace Apt::AptEditor
\ No newline at end of file
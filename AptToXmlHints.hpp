@@ -1,10 +1,16 @@
 // provide xml comment hints for AptToXml
 #pragma once
 #include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <filesystem>
 #include <functional>
 #include <map>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -16,8 +22,8 @@
 
 namespace Apt::AptEditor::AptToXmlHints {
 
-tinyxml2::XMLNode* appendXmlComment(tinyxml2::XMLNode* parent,
-                                    const std::string& comment) {
+inline tinyxml2::XMLNode* appendXmlComment(tinyxml2::XMLNode* parent,
+                                           const std::string& comment) {
     if (parent == nullptr) {
         throw std::runtime_error{ "parent node is nullptr" };
     }
@@ -25,9 +31,24 @@ tinyxml2::XMLNode* appendXmlComment(tinyxml2::XMLNode* parent,
     return parent->InsertEndChild(node);
 }
 
+// shortest text which reads back as the same value, Float32 included, instead
+// of tinyxml2's snprintf("%f") which both costs more and loses digits
+template <typename T>
+inline void setNumberAttribute(tinyxml2::XMLElement* node, const char* name, const T value) {
+    static_assert(std::is_arithmetic_v<T>);
+    auto buffer = std::array<char, 32>{};
+    const auto [end, error] =
+        std::to_chars(buffer.data(), buffer.data() + buffer.size() - 1, value);
+    if (error != std::errc{}) {
+        throw std::logic_error{ "Cannot format number" };
+    }
+    *end = '\0';
+    node->SetAttribute(name, buffer.data());
+}
+
 using References = std::map<AptTypes::Address, std::size_t>;
-References getReferenceDescriptions(const AptTypes::AptObjectPool& pool,
-                                    const AptTypes::Address entryOffset) {
+inline References getReferenceDescriptions(const AptTypes::AptObjectPool& pool,
+                                           const AptTypes::Address entryOffset) {
     auto references = References{};
 
     using Levels = AptTypes::AptType::NameStack;
@@ -111,6 +132,10 @@ References getReferenceDescriptions(const AptTypes::AptObjectPool& pool,
             const auto currentChunks = getMergedChunk(chunks, levels);
             // references for array
             setter(pointerToArray.address, currentChunks);
+            if (pool.plainArrays.count(pointerToArray.address) > 0) {
+                // plain data does not point anywhere
+                return;
+            }
 
             const auto typeSize = pool.getType(pointerToArray.typePointedTo).size();
             for (auto i = AptTypes::Address{ 0 }; i < value.length; ++i) {
@@ -161,9 +186,26 @@ References getReferenceDescriptions(const AptTypes::AptObjectPool& pool,
     return references;
 }
 
+// objects reachable through more than one pointer, as in .apt files written with
+// deduplication; the xml has only one place for each object
+class SharedObjectError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// what commands going through the xml say instead of the SharedObjectError
+inline std::runtime_error sharedMovieError(const std::filesystem::path& aptFileName,
+                                           const std::string_view command) {
+    return std::runtime_error{ aptFileName.string() +
+                               " shares objects between several users (written with "
+                               "--dedup?), so " + std::string{ command } +
+                               " cannot be used on it; convert the .xml it came from "
+                               "again without --dedup and use that instead" };
+}
+
 using ParentMap = std::map<AptTypes::Address, std::pair<AptTypes::Address, AptTypes::AptType::NameStack>>;
-ParentMap getParentMap(const AptTypes::AptObjectPool& pool,
-                        const AptTypes::Address entryOffset) {
+inline ParentMap getParentMap(const AptTypes::AptObjectPool& pool,
+                               const AptTypes::Address entryOffset) {
     auto parentMap = ParentMap{};
 
     using AddressStack = std::vector<AptTypes::Address>;
@@ -171,7 +213,10 @@ ParentMap getParentMap(const AptTypes::AptObjectPool& pool,
                                      const AptTypes::AptType::NameStack& nameStack,
                                      const AddressStack& addressStack) {
         if(parentMap.count(targetAddress) > 0) {
-            throw std::runtime_error{ "Unknown case!" };
+            // e.g. .apt files written with deduplication
+            throw SharedObjectError{ "Object at " + std::to_string(targetAddress) +
+                                      " is referenced from more than one place, "
+                                      "shared objects cannot be converted to xml" };
         }
         parentMap.emplace(targetAddress, std::pair{ addressStack.back(), nameStack });
     };
@@ -239,6 +284,10 @@ ParentMap getParentMap(const AptTypes::AptObjectPool& pool,
 
             // references for array
             setter(pointerToArray.address, nameStack, addressStack);
+            if (pool.plainArrays.count(pointerToArray.address) > 0) {
+                // plain data does not point anywhere
+                return;
+            }
 
             const auto typeSize = pool.getType(pointerToArray.typePointedTo).size();
             auto newAddressStack = addressStack;
@@ -291,44 +340,59 @@ ParentMap getParentMap(const AptTypes::AptObjectPool& pool,
     return parentMap;
 }
 
-std::string hintForConstantID(const ConstFile::ConstData& constData,
-                              const AptTypes::AptType& instruction) {
+// appends the same text as operator<< would, without going through a stream
+inline void appendConstantValue(std::string& destination,
+                                const ConstFile::ConstItem& constant) {
+    const auto valueVisitor = [&destination](const auto& value) {
+        using Type = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<Type, std::string_view>) {
+            destination += value;
+        }
+        else if constexpr (std::is_same_v<Type, bool>) {
+            destination += value ? '1' : '0';
+        }
+        else if constexpr (std::is_same_v<Type, float>) {
+            char buffer[32];
+            const auto length = std::snprintf(buffer, sizeof(buffer), "%g", value);
+            destination.append(buffer, static_cast<std::size_t>(length));
+        }
+        else if constexpr (not std::is_same_v<Type, std::nullptr_t>) {
+            char buffer[16];
+            const auto [end, error] = std::to_chars(std::begin(buffer), std::end(buffer), value);
+            destination.append(buffer, end);
+        }
+    };
+    std::visit(valueVisitor, constant.data);
+}
+
+inline std::string hintForConstantID(const AptTypes::AptObjectPool& pool,
+                                     const ConstFile::ConstData& constData,
+                                     const AptTypes::AptType& instruction) {
     if (instruction.typeName == "ConstantPool") {
         // TODO
         return {};
     }
 
-    const auto containsConstantID = [](const auto& pair) {
-        static constexpr auto constantID = std::string_view{ "constantID" };
-        const auto& memberName = pair.first;
-        return std::search(memberName.begin(),
-                           memberName.end(),
-                           constantID.begin(),
-                           constantID.end(),
-                           [](const char a, const char b) {
-                               return std::toupper(a) == std::toupper(b);
-                           }) != memberName.end();
-    };
-
-    const auto constantIDIndex = instruction.findIf(containsConstantID);
-    if (not constantIDIndex.has_value()) {
+    const auto* typeData = pool.findTypeData(instruction.typeName);
+    if (typeData == nullptr or not typeData->constantIDMember.has_value()) {
         return {};
     }
-    const auto constantID =
-        instruction.at(constantIDIndex.value()).getNumericValue<std::size_t>();
+    const auto constantID = instruction.at(typeData->constantIDMember.value())
+                                .getNumericValue<std::uint32_t>();
 
-    const auto& constantData = constData.items.at(constantID);
+    const auto constantData = constData.itemAt(constantID);
     if (std::holds_alternative<std::nullptr_t>(constantData.data)) {
         return {};
     }
 
-    auto constant = std::string{};
-    const auto constantVisitor = [&constant](const auto& value) {
-        constant = asString(value);
-    };
-    std::visit(constantVisitor, constantData.data);
+    auto constantIDText = std::array<char, 16>{};
+    const auto [constantIDEnd, error] =
+        std::to_chars(constantIDText.data(), constantIDText.data() + constantIDText.size(), constantID);
 
-    const auto hintText = asString("ConstantID ", constantID, " is ", constant);
+    auto hintText = std::string{ "ConstantID " };
+    hintText.append(constantIDText.data(), constantIDEnd);
+    hintText += " is ";
+    appendConstantValue(hintText, constantData);
     return hintText;
 }
 } // namespace Apt::AptEditor::AptToXmlHints
\ No newline at end of file
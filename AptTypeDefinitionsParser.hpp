@@ -1,8 +1,10 @@
 #pragma once
 #include "AptTypes.hpp"
 #include "Util.hpp"
+#include <algorithm>
 #include <cctype>
 #include <ciso646>
+#include <filesystem>
 #include <optional>
 #include <stdexcept>
 #include <string_view>
@@ -38,7 +40,7 @@ struct CurrentAptTypes {
     TypeDataMap& newTypes;
 };
 
-DerivedTypeData parseDerivedTypes(std::string_view deriveDefiniton) {
+inline DerivedTypeData parseDerivedTypes(std::string_view deriveDefiniton) {
     auto derivedTypesData = DerivedTypeData{};
     while (not deriveDefiniton.empty()) {
         const auto typeTag =
@@ -77,8 +79,28 @@ DerivedTypeData parseDerivedTypes(std::string_view deriveDefiniton) {
     return derivedTypesData;
 }
 
-TypeDataMapEntry readTypeDefinition(std::string_view typeDefinition,
-                                    const CurrentAptTypes& existingTypes) {
+// first member whose name contains "constantID", ignoring case
+inline std::optional<std::size_t> findConstantIDMember(const AptType::MemberArray& members) {
+    static constexpr auto constantID = std::string_view{ "constantID" };
+    const auto containsConstantID = [](const auto& pair) {
+        const auto& memberName = pair.first;
+        return std::search(memberName.begin(),
+                           memberName.end(),
+                           constantID.begin(),
+                           constantID.end(),
+                           [](const char a, const char b) {
+                               return std::toupper(a) == std::toupper(b);
+                           }) != memberName.end();
+    };
+    const auto member = std::find_if(members.begin(), members.end(), containsConstantID);
+    if (member == members.end()) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(std::distance(members.begin(), member));
+}
+
+inline TypeDataMapEntry readTypeDefinition(std::string_view typeDefinition,
+                                           const CurrentAptTypes& existingTypes) {
     auto typeData = TypeData{};
     const auto typeName = trim(readUntil(typeDefinition, "="));
     typeData.type.typeName = typeName;
@@ -114,10 +136,11 @@ TypeDataMapEntry readTypeDefinition(std::string_view typeDefinition,
 
         typeDefinition = trim(typeDefinition);
     }
+    typeData.constantIDMember = findConstantIDMember(memberArray);
     return TypeDataMapEntry{ typeName, std::move(typeData) };
 }
 
-void readTypeDefinitions(std::string_view input, AptObjectPool& aptObjectPool) {
+inline void readTypeDefinitions(std::string_view input, AptObjectPool& aptObjectPool) {
     auto currentTypeMap = TypeDataMap{};
     auto currentTypeMaps = CurrentAptTypes{ aptObjectPool, currentTypeMap };
     while (not input.empty()) {
@@ -130,4 +153,16 @@ void readTypeDefinitions(std::string_view input, AptObjectPool& aptObjectPool) {
         throw std::runtime_error{ "Some types are not merged into pool!" };
     }
 }
+
+// read a definition file after stripping its /* comments */
+inline void readTypeDefinitionFile(const std::filesystem::path& fileName,
+                                   AptObjectPool& aptObjectPool) {
+    auto definitionFile = readEntireFile(fileName);
+    while (definitionFile.find("/*") != definitionFile.npos) {
+        const auto begin = definitionFile.find("/*");
+        const auto end = definitionFile.find("*/", begin + 2) + 2;
+        definitionFile.erase(begin, (end - begin));
+    }
+    readTypeDefinitions(definitionFile, aptObjectPool);
+}
 } // namespace Apt::AptTypes::Parser
\ No newline at end of file
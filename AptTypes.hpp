@@ -1,5 +1,6 @@
 #pragma once
 #include "AptAptParseUtilities.hpp"
+#include "AptAptWriteUtilities.hpp"
 #include "Util.hpp"
 #include <cctype>
 #include <ciso646>
@@ -18,21 +19,33 @@ namespace Apt::AptTypes {
 
 using DataSource = AptParseUtilities::UnparsedData;
 using DataReader = AptParseUtilities::UnparsedData::UnparsedDataView;
+using DataDestination = AptWriteUtilities::OutputData;
+using DataWriter = AptWriteUtilities::OutputData::OutputDataView;
 
 using Address = std::uint32_t;
 using AddressDifference = std::int32_t;
 
-template <typename T>
+// readers are specialized on the byte order of the .apt, see
+// AptObjectPool::constructObject
+template <Endianness byteOrder, typename T>
 void readerReadValue(DataReader& reader, T& value) {
     static_assert(std::is_arithmetic_v<T>);
-    value = reader.readFrontAs<T>();
+    value = readCharsAs<T, byteOrder>(reader.readFront(sizeof(T)));
 }
 
+template <Endianness byteOrder>
 void readerReadValue(DataReader& reader, std::string& value) {
-    for (auto next = std::string_view{}; next.find('\0') == next.npos;
-         next = reader.readFront(1)) {
-        value += next;
+    const auto remaining = reader.remaining();
+    const auto* terminator = static_cast<const char*>(
+        std::memchr(remaining.data(), '\0', remaining.size()));
+    if (terminator == nullptr) {
+        throw std::out_of_range{ "Unterminated string at " +
+                                 std::to_string(reader.absolutePosition()) };
     }
+    const auto length = static_cast<std::size_t>(terminator - remaining.data());
+    value.assign(remaining.data(), length);
+    // the terminator is read as well
+    reader.readFront(length + 1);
 }
 
 struct PaddingForAlignment {
@@ -40,11 +53,13 @@ struct PaddingForAlignment {
     std::uint32_t actuallyPadded;
 };
 
+template <Endianness byteOrder>
 void readerReadValue(DataReader& reader, PaddingForAlignment& value) {
-    value.actuallyPadded = 0;
-    while (reader.absolutePosition() % value.align != 0) {
-        const auto read = reader.readFront(1);
-        value.actuallyPadded += read.size();
+    const auto misalignment = reader.absolutePosition() % value.align;
+    value.actuallyPadded =
+        misalignment == 0 ? 0 : static_cast<std::uint32_t>(value.align - misalignment);
+    if (value.actuallyPadded != 0) {
+        reader.readFront(value.actuallyPadded);
     }
 }
 
@@ -53,8 +68,9 @@ struct AptTypePointer {
     Address address;
 };
 
+template <Endianness byteOrder>
 void readerReadValue(DataReader& reader, AptTypePointer& value) {
-    value.address = reader.readFrontAs<Address>();
+    readerReadValue<byteOrder>(reader, value.address);
 }
 
 struct PointerToArray {
@@ -65,19 +81,56 @@ struct PointerToArray {
     static constexpr auto unsetLength = (std::numeric_limits<std::size_t>::max)();
 };
 
+template <Endianness byteOrder>
 void readerReadValue(DataReader& reader, PointerToArray& value) {
-    value.pointerToArray.address = reader.readFrontAs<Address>();
+    readerReadValue<byteOrder>(reader, value.pointerToArray.address);
 }
 
 struct Unsigned24 {
     std::uint32_t value;
 };
 
+template <Endianness byteOrder>
 void readerReadValue(DataReader& reader, Unsigned24& value) {
-    // assuming little endian
     const auto data = reader.readFront(3);
     value.value = 0;
-    std::memcpy(&value.value, data.data(), data.size());
+    if constexpr (byteOrder == Endianness::big) {
+        for (const auto byte : data) {
+            value.value = (value.value << 8) | static_cast<std::uint8_t>(byte);
+        }
+    }
+    else {
+        // assuming little endian
+        std::memcpy(&value.value, data.data(), data.size());
+    }
+}
+
+template <typename T>
+void writerWriteValue(DataWriter& writer, const T& value) {
+    static_assert(std::is_arithmetic_v<T>);
+    writer.writeFrontAs(value);
+}
+
+inline void writerWriteValue(DataWriter& writer, const std::string& value) {
+    writer.writeFront(value);
+    writer.writeFrontAs('\0');
+}
+
+inline void writerWriteValue(DataWriter& writer, const PaddingForAlignment& value) {
+    writer.skipFront(value.actuallyPadded);
+}
+
+inline void writerWriteValue(DataWriter& writer, const AptTypePointer& value) {
+    writer.writeFrontAs(value.address);
+}
+
+inline void writerWriteValue(DataWriter& writer, const PointerToArray& value) {
+    writer.writeFrontAs(value.pointerToArray.address);
+}
+
+inline void writerWriteValue(DataWriter& writer, const Unsigned24& value) {
+    // assuming little endian
+    writer.writeFront(std::string_view{ reinterpret_cast<const char*>(&value.value), 3 });
 }
 
 struct AptType {
@@ -170,6 +223,23 @@ struct AptType {
         return result;
     }
 
+    template <typename T>
+    void setNumericValue(const T newValue) {
+        const auto assignmentVisitor = [newValue](auto& value) {
+            using Type = std::decay_t<decltype(value)>;
+            if constexpr (std::is_arithmetic_v<Type>) {
+                value = static_cast<Type>(newValue);
+            }
+            else if constexpr (std::is_same_v<Type, Unsigned24>) {
+                value.value = static_cast<std::uint32_t>(newValue) & 0xFFFFFF;
+            }
+            else {
+                throw std::invalid_argument{ "Cannot assign numeric value" };
+            }
+        };
+        std::visit(assignmentVisitor, this->value);
+    }
+
     using NameStack = std::vector<std::string>;
     template <typename Self, typename Visitor>
     static void forEachRecursive(Self& self, Visitor& visitor, const NameStack& nameStack) {
@@ -214,7 +284,48 @@ struct AptType {
     std::size_t overridenSize = 0;
 };
 
-const AptType* getBuiltInType(const std::string_view typeName) {
+// reads the value of a type made of numbers only, see PlainDataArray
+inline void decodePlainData(AptType& instance, std::string_view& data) {
+    const auto visitor = [&data](auto& value) {
+        using Type = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<Type, AptType::MemberArray>) {
+            for (auto& [memberName, member] : value) {
+                decodePlainData(member, data);
+            }
+        }
+        else if constexpr (std::is_arithmetic_v<Type>) {
+            std::memcpy(&value, splitFront(data, sizeof(Type)).data(), sizeof(Type));
+        }
+        else if constexpr (std::is_same_v<Type, Unsigned24>) {
+            // assuming little endian
+            value.value = 0;
+            std::memcpy(&value.value, splitFront(data, 3).data(), 3);
+        }
+        else {
+            throw std::logic_error{ "Not plain data" };
+        }
+    };
+    std::visit(visitor, instance.value);
+}
+
+// An array whose elements only hold numbers (no pointers, strings, paddings,
+// derived types or actions), kept as the bytes of the .apt instead of one
+// object per element. Elements are decoded when asked for.
+struct PlainDataArray {
+    AptType elementType;
+    std::size_t length;
+    std::string bytes;
+
+    AptType element(const std::size_t index) const {
+        const auto elementSize = this->elementType.size();
+        auto data = std::string_view{ this->bytes }.substr(index * elementSize, elementSize);
+        auto element = this->elementType;
+        decodePlainData(element, data);
+        return element;
+    }
+};
+
+inline const AptType* getBuiltInType(const std::string_view typeName) {
     const auto initialization = [] {
         const auto declareType = [](auto&& name, auto&& value, std::size_t size = 0) {
             return std::pair{ std::forward<decltype(name)>(name),
@@ -259,8 +370,15 @@ struct AptObjectPool {
     struct TypeData {
         AptType type;
         std::optional<DerivedTypeData> derivedTypes;
+        // index of the member holding a constant id, resolved once when loading definitions
+        std::optional<std::size_t> constantIDMember;
     };
 
+    const TypeData* findTypeData(const std::string_view typeName) const {
+        const auto typeData = this->types.find(typeName);
+        return typeData == this->types.end() ? nullptr : &typeData->second;
+    }
+
     using TypeDataMap = std::map<std::string, TypeData, std::less<>>;
 
     static AptType parsePaddingDeclaration(std::string_view paddingTypeName) {
@@ -376,18 +494,50 @@ struct AptObjectPool {
         return derivedTypeName;
     }
 
+    bool isPlainData(const AptType& type) const {
+        if (const auto* typeData = this->findTypeData(type.typeName);
+            typeData != nullptr and typeData->derivedTypes.has_value()) {
+            return false;
+        }
+        const auto visitor = [this](const auto& value) {
+            using Type = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<Type, AptType::MemberArray>) {
+                for (const auto& [memberName, member] : value) {
+                    // the instructions still need to be fetched
+                    if (memberName == "actionDataOffset" or not this->isPlainData(member)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            else {
+                return std::is_arithmetic_v<Type> or std::is_same_v<Type, Unsigned24>;
+            }
+        };
+        return std::visit(visitor, type.value);
+    }
+
+    // the byte order is checked once per object, not for every value
     AptType constructObject(AptType instance, DataReader& reader) const {
+        if (this->sourceEndianness == Endianness::big) {
+            return this->constructObjectAs<Endianness::big>(std::move(instance), reader);
+        }
+        return this->constructObjectAs<Endianness::little>(std::move(instance), reader);
+    }
+
+    template <Endianness byteOrder>
+    AptType constructObjectAs(AptType instance, DataReader& reader) const {
         auto readerInOriginalState = reader;
 
         const auto visitor = [this, &reader](auto& value) {
             using Type = std::decay_t<decltype(value)>;
             if constexpr (std::is_same_v<Type, AptType::MemberArray>) {
                 for (auto& [memberName, member] : value) {
-                    member.value = this->constructObject(member, reader).value;
+                    member.value = this->constructObjectAs<byteOrder>(member, reader).value;
                 }
             }
             else {
-                readerReadValue(reader, value);
+                readerReadValue<byteOrder>(reader, value);
             }
         };
         std::visit(visitor, instance.value);
@@ -397,27 +547,84 @@ struct AptObjectPool {
             // reconstuct using derived type.value);
             // reader is in its original state
             reader = readerInOriginalState;
-            instance = this->constructObject(this->getType(*derivedTypeName), reader);
+            instance = this->constructObjectAs<byteOrder>(this->getType(*derivedTypeName), reader);
         }
 
-        // set array length
-        if (std::holds_alternative<AptType::MemberArray>(instance.value)) {
-            auto& members = std::get<AptType::MemberArray>(instance.value);
-            for (auto& [memberName, member] : members) {
-                if (not std::holds_alternative<PointerToArray>(member.value)) {
-                    continue;
-                }
-                auto& array = std::get<PointerToArray>(member.value);
-                const auto lengthIndex = instance.find(array.arraySizeVariable);
-                if (not lengthIndex.has_value()) {
-                    throw std::invalid_argument{ "Array length parameter not found" };
+        setArrayLengths(instance);
+        return instance;
+    }
+
+    // array lengths are read from the member named by each PointerToArray
+    static void setArrayLengths(AptType& instance) {
+        if (not std::holds_alternative<AptType::MemberArray>(instance.value)) {
+            return;
+        }
+        auto& members = std::get<AptType::MemberArray>(instance.value);
+        for (auto& [memberName, member] : members) {
+            if (not std::holds_alternative<PointerToArray>(member.value)) {
+                continue;
+            }
+            auto& array = std::get<PointerToArray>(member.value);
+            const auto lengthIndex = instance.find(array.arraySizeVariable);
+            if (not lengthIndex.has_value()) {
+                throw std::invalid_argument{ "Array length parameter not found" };
+            }
+            array.length =
+                instance.at(lengthIndex.value()).getNumericValue<std::size_t>();
+        }
+    }
+
+    void writeObject(const AptType& instance, DataWriter& writer) const {
+        const auto visitor = [this, &writer](const auto& value) {
+            using Type = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<Type, AptType::MemberArray>) {
+                for (const auto& [memberName, member] : value) {
+                    this->writeObject(member, writer);
                 }
-                array.length =
-                    instance.at(lengthIndex.value()).getNumericValue<std::size_t>();
             }
+            else {
+                writerWriteValue(writer, value);
+            }
+        };
+        std::visit(visitor, instance.value);
+    }
+
+    // write every object of this pool at its own address
+    void writeAllObjects(DataDestination& destination) const {
+        for (const auto& [address, object] : this->objectInstances) {
+            auto writer = destination.getViewAt(address);
+            this->writeObject(object, writer);
+        }
+        for (const auto& [address, array] : this->plainArrays) {
+            auto writer = destination.getViewAt(address);
+            writer.writeFront(array.bytes);
         }
+    }
 
-        return instance;
+    // replaces the PlainDataArray containing address, if any, by its elements
+    void expandPlainArrayAt(const Address address) {
+        const auto found = this->plainArrays.upper_bound(address);
+        if (found == this->plainArrays.begin()) {
+            return;
+        }
+        const auto array = std::prev(found);
+        const auto& [begin, plainArray] = *array;
+        const auto elementSize = plainArray.elementType.size();
+        if (address >= begin + plainArray.length * elementSize) {
+            return;
+        }
+        for (auto i = std::size_t{ 0 }; i < plainArray.length; ++i) {
+            this->insertObject(plainArray.element(i),
+                               begin + static_cast<Address>(i * elementSize));
+        }
+        this->plainArrays.erase(array);
+    }
+
+    // for code which needs every element as an object
+    void expandPlainArrays() {
+        while (not this->plainArrays.empty()) {
+            this->expandPlainArrayAt(this->plainArrays.begin()->first);
+        }
     }
 
     DataReader getReaderAtOffset(const Address offset) {
@@ -488,6 +695,8 @@ struct AptObjectPool {
                 // null pointer
                 return;
             }
+            // something points into an array read as plain data
+            this->expandPlainArrayAt(pointer.address);
 
             // avoid infinite loop when apt objects have circular references
             if (std::find(fetching.cbegin(), fetching.cend(), pointer.address) !=
@@ -522,11 +731,28 @@ struct AptObjectPool {
             if (length == PointerToArray::unsetLength) {
                 throw std::runtime_error{ "Array size not set!" };
             }
-            const auto elementSize = this->getType(pointerValue.typePointedTo).size();
+            const auto elementType = this->getType(pointerValue.typePointedTo);
+            const auto elementSize = elementType.size();
 
             const auto begin = pointerValue.address;
             const auto end = pointerValue.address + length * elementSize;
 
+            if (this->plainArrays.count(begin) > 0) {
+                return;
+            }
+            if (this->plainArraysAsSpans and length > 0 and
+                this->isPlainData(elementType) and not this->hasObjectsIn(begin, end)) {
+                auto reader = this->getReaderAtOffset(begin);
+                auto bytes = std::string{ reader.readFront(end - begin) };
+                if (this->sourceEndianness == Endianness::big) {
+                    toLittleEndian(bytes, elementType);
+                }
+                this->insertArrayData(begin, end);
+                this->plainArrays.emplace(
+                    begin, PlainDataArray{ elementType, length, std::move(bytes) });
+                return;
+            }
+
             auto currentPointer = pointerValue;
             for (currentPointer.address = begin; currentPointer.address < end;
                  currentPointer.address += elementSize) {
@@ -551,10 +777,97 @@ struct AptObjectPool {
         source.forEachRecursive(std::bind(visitor, visitor, std::placeholders::_1));
     }
 
+    // plain data is kept little endian like the rest of the pool; elements made of
+    // values of one width are swapped in bulk
+    static void toLittleEndian(std::string& bytes, const AptType& elementType) {
+        auto widths = std::vector<std::size_t>{};
+        elementType.forEachRecursive([&widths](const auto& value, const AptType::NameStack&) {
+            using Type = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<Type, Unsigned24>) {
+                widths.emplace_back(3);
+            }
+            else {
+                widths.emplace_back(sizeof(Type));
+            }
+        });
+        if (std::adjacent_find(widths.begin(), widths.end(), std::not_equal_to<>{}) ==
+            widths.end()) {
+            byteSwapEach(bytes.data(), bytes.size(), widths.front());
+            return;
+        }
+        for (auto current = bytes.data(); current != bytes.data() + bytes.size();) {
+            for (const auto width : widths) {
+                std::reverse(current, current + width);
+                current += width;
+            }
+        }
+    }
+
+    bool hasObjectsIn(const Address begin, const Address end) const {
+        const auto next = this->objectInstances.lower_bound(begin);
+        if (next != this->objectInstances.end() and next->first < end) {
+            return true;
+        }
+        if (next == this->objectInstances.begin()) {
+            return false;
+        }
+        const auto& [address, previous] = *std::prev(next);
+        return address + previous.size() > begin;
+    }
+
+    // lazy access: unlike fetchPointedObjects, only the requested object is read from
+    // dataSource, the first time it is asked for; later requests return the same
+    // instance. References stay valid while the pool is alive.
+    const AptType& getObject(const Address address, const std::string_view typeName) {
+        const auto type = this->getType(typeName);
+        if (const auto existing = this->objectInstances.find(address);
+            existing != this->objectInstances.end()) {
+            const auto& [existingAddress, object] = *existing;
+            if (not this->isSameOrDerivedFrom(object, type.typeName)) {
+                throw std::runtime_error{ "Another type already exists here: " +
+                                          object.typeName };
+            }
+            return object;
+        }
+
+        auto reader = this->getReaderAtOffset(address);
+        this->insertObject(this->constructObject(type, reader), address);
+        return this->objectInstances.at(address);
+    }
+
+    // nullptr for null pointers
+    const AptType* resolve(const AptTypePointer& pointer) {
+        if (pointer.address == 0) {
+            return nullptr;
+        }
+        return &this->getObject(pointer.address, pointer.typePointedTo);
+    }
+
+    const AptType& arrayElement(const PointerToArray& array, const std::size_t index) {
+        if (array.length == PointerToArray::unsetLength) {
+            throw std::runtime_error{ "Array size not set!" };
+        }
+        if (index >= array.length) {
+            throw std::out_of_range{ "Array index " + std::to_string(index) +
+                                     " out of range, length " +
+                                     std::to_string(array.length) };
+        }
+        const auto& pointer = array.pointerToArray;
+        const auto elementSize = this->getType(pointer.typePointedTo).size();
+        return this->getObject(pointer.address + static_cast<Address>(index * elementSize),
+                               pointer.typePointedTo);
+    }
+
     DataSource dataSource;
     TypeDataMap types;
     std::map<Address, AptType> objectInstances;
     std::map<Address, Address> arrays; //(begin address, past the end address)
+    // by begin address, only filled by fetchPointedObjects when plainArraysAsSpans is
+    // set; every other array element is in objectInstances
+    std::map<Address, PlainDataArray> plainArrays;
+    bool plainArraysAsSpans = false;
+    // byte order of dataSource, objects always hold native values
+    Endianness sourceEndianness = Endianness::little;
     // std::map<Address, std::string> fetching;
 };
 
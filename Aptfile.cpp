@@ -3,11 +3,11 @@
 #include <Windows.h>
 #include <assert.h>
 
-bool AptFile::Convert(std::string filename)
+bool AptFile::Convert(std::string filename, bool dedupconstants)
 {
 	std::filesystem::path file(filename);
 	if (file.extension() == ".xml")
-		return XMLToApt(filename);
+		return XMLToApt(filename, dedupconstants);
 	else if (file.extension() == ".apt")
 		return AptToXML(filename);
     else if (file.extension() == ".big")
@@ -653,7 +653,7 @@ bool AptFile::AptToXML(std::string filename)
 	return true;
 }
 
-bool AptFile::XMLToApt(std::string filename)
+bool AptFile::XMLToApt(std::string filename, bool dedupconstants)
 {
 	auto xmlfile = std::filesystem::path{filename};
 	auto constfile = std::filesystem::path{xmlfile}.replace_extension(".const");
@@ -683,6 +683,7 @@ bool AptFile::XMLToApt(std::string filename)
 	tinyxml2::XMLElement *entry, *entry2, *entry3, *entry4, *entry5, *entry6;
 	AptConstData* data = new AptConstData();
 	data->itemcount = 0;
+	data->deduplicate = dedupconstants;
 
 	Movie *m = new Movie;
 	m->type = MOVIE;
@@ -698,7 +699,7 @@ bool AptFile::XMLToApt(std::string filename)
 	m->count = 0;
 	for (entry = node->FirstChildElement(); entry != 0; entry = entry->NextSiblingElement())
 	{
-		if (std::string(entry->Value())=="movieclip")
+		if (!strcmp(entry->Value(), "movieclip"))
 		{
 			entry2 = entry->FirstChildElement();
     		for (entry3 = entry2->FirstChildElement(); entry3 != 0; entry3 = entry3->NextSiblingElement())
@@ -730,7 +731,8 @@ bool AptFile::XMLToApt(std::string filename)
 				m->frames.push_back(f);
 				for (entry4 = entry3->FirstChildElement(); entry4 != 0; entry4 = entry4->NextSiblingElement())
 				{
-                    if (std::string(entry4->Value()) == "action")
+					const uint32_t itemtype = GetFrameItemType(entry4->Value());
+                    if (itemtype == ACTION)
 					{
 						f->frameitemcount++;
 						Action *a = new Action;
@@ -744,7 +746,7 @@ bool AptFile::XMLToApt(std::string filename)
 						ActionHelper::XML_ProcessActions(entry4, &a->ab, data);
 						f->frameitems.push_back(a);
 					}
-					if (std::string(entry4->Value())== "framelabel")
+					if (itemtype == FRAMELABEL)
 					{
 						FrameLabel *l;
 						l = new FrameLabel;
@@ -755,7 +757,7 @@ bool AptFile::XMLToApt(std::string filename)
 						f->frameitems.push_back(l);
 						f->frameitemcount++;
 					}
-					if (std::string(entry4->Value())== "placeobject")
+					if (itemtype == PLACEOBJECT)
 					{
 						f->frameitemcount++;
 						PlaceObject *po = new PlaceObject;
@@ -825,7 +827,7 @@ bool AptFile::XMLToApt(std::string filename)
 							po->poa = 0;
 						}
 					}
-					if (std::string(entry4->Value())== "removeobject")
+					if (itemtype == REMOVEOBJECT)
 					{
 						RemoveObject *ro;
 						ro = new RemoveObject;
@@ -834,7 +836,7 @@ bool AptFile::XMLToApt(std::string filename)
 						f->frameitems.push_back(ro);
 						f->frameitemcount++;
 					}
-                    else if (std::string(entry4->Value())== "background")
+                    else if (itemtype == BACKGROUNDCOLOR)
 					{
 						BackgroundColor *b;
 						b = new BackgroundColor;
@@ -843,7 +845,7 @@ bool AptFile::XMLToApt(std::string filename)
 						f->frameitems.push_back(b);
 						f->frameitemcount++;
 					}
-					else if (std::string(entry4->Value())== "initaction")
+					else if (itemtype == INITACTION)
 					{
 						f->frameitemcount++;
 						InitAction *a = new InitAction;
@@ -861,7 +863,7 @@ bool AptFile::XMLToApt(std::string filename)
 				}
 			}
 		}
-		else if (std::string(entry->Value())== "shape")
+		else if (!strcmp(entry->Value(), "shape"))
 		{
 			m->charactercount++;
 			Shape *sh = new Shape;
@@ -874,7 +876,7 @@ bool AptFile::XMLToApt(std::string filename)
 			sh->geometry = entry->IntAttribute("geometry");
 			m->characters.push_back(sh);
 		}
-		else if (std::string(entry->Value())== "edittext")
+		else if (!strcmp(entry->Value(), "edittext"))
 		{
 			m->charactercount++;
 			EditText *sh = new EditText;
@@ -923,7 +925,7 @@ bool AptFile::XMLToApt(std::string filename)
 			}
 			m->characters.push_back(sh);
 		}
-        else if (std::string(entry->Value())== "font")
+        else if (!strcmp(entry->Value(), "font"))
 		{
 			m->charactercount++;
 			Font *sh = new Font;
@@ -943,7 +945,7 @@ bool AptFile::XMLToApt(std::string filename)
 			}
 			m->characters.push_back(sh);
 		}
-		else if (std::string(entry->Value())== "button")
+		else if (!strcmp(entry->Value(), "button"))
 		{
 			m->charactercount++;
 			Button *b = new Button;
@@ -1043,7 +1045,7 @@ bool AptFile::XMLToApt(std::string filename)
 				}
 			}
 		}
-        else if (std::string(entry->Value())== "sprite")
+        else if (!strcmp(entry->Value(), "sprite"))
 		{
 			m->charactercount++;
 			Sprite *sp = new Sprite;
@@ -1063,7 +1065,8 @@ bool AptFile::XMLToApt(std::string filename)
 					sp->frames.push_back(f);
 					for (entry4 = entry3->FirstChildElement(); entry4 != 0; entry4 = entry4->NextSiblingElement())
 					{
-						if (!_stricmp(entry4->Value(), "action"))
+						const uint32_t itemtype = GetFrameItemType(entry4->Value());
+						if (itemtype == ACTION)
 						{
 							f->frameitemcount++;
 							Action *a = new Action;
@@ -1077,7 +1080,7 @@ bool AptFile::XMLToApt(std::string filename)
 							ActionHelper::XML_ProcessActions(entry4, &a->ab, data);
 							f->frameitems.push_back(a);
 						}
-						if (!_stricmp(entry4->Value(), "framelabel"))
+						if (itemtype == FRAMELABEL)
 						{
 							FrameLabel *l;
 							l = new FrameLabel;
@@ -1088,7 +1091,7 @@ bool AptFile::XMLToApt(std::string filename)
 							f->frameitems.push_back(l);
 							f->frameitemcount++;
 						}
-						if (!_stricmp(entry4->Value(), "placeobject"))
+						if (itemtype == PLACEOBJECT)
 						{
 							f->frameitemcount++;
 							PlaceObject *po = new PlaceObject;
@@ -1157,7 +1160,7 @@ bool AptFile::XMLToApt(std::string filename)
 								po->poa = 0;
 							}
 						}
-						if (!_stricmp(entry4->Value(), "removeobject"))
+						if (itemtype == REMOVEOBJECT)
 						{
 							RemoveObject *ro;
 							ro = new RemoveObject;
@@ -1166,7 +1169,7 @@ bool AptFile::XMLToApt(std::string filename)
 							f->frameitems.push_back(ro);
 							f->frameitemcount++;
 						}
-						if (!_stricmp(entry4->Value(), "background"))
+						if (itemtype == BACKGROUNDCOLOR)
 						{
 							BackgroundColor *b;
 							b = new BackgroundColor;
@@ -1175,7 +1178,7 @@ bool AptFile::XMLToApt(std::string filename)
 							f->frameitems.push_back(b);
 							f->frameitemcount++;
 						}
-						if (!_stricmp(entry4->Value(), "initaction"))
+						if (itemtype == INITACTION)
 						{
 							f->frameitemcount++;
 							InitAction *a = new InitAction;
@@ -1194,7 +1197,7 @@ bool AptFile::XMLToApt(std::string filename)
 				}
 			}
 		}
-        else if (std::string(entry->Value())== "image")
+        else if (!strcmp(entry->Value(), "image"))
 		{
 			m->charactercount++;
 			Image *sh = new Image;
@@ -1203,7 +1206,7 @@ bool AptFile::XMLToApt(std::string filename)
 			sh->texture = entry->IntAttribute("image");
 			m->characters.push_back(sh);
 		}
-		else if (std::string(entry->Value())== "morph")
+		else if (!strcmp(entry->Value(), "morph"))
 		{
 			m->charactercount++;
 			Morph *sh = new Morph;
@@ -1213,7 +1216,7 @@ bool AptFile::XMLToApt(std::string filename)
 			sh->endshape = entry->IntAttribute("end");;
 			m->characters.push_back(sh);
 		}
-        else if (std::string(entry->Value())== "text")
+        else if (!strcmp(entry->Value(), "text"))
 		{
 			m->charactercount++;
 			Text *sh = new Text;
@@ -1267,7 +1270,7 @@ bool AptFile::XMLToApt(std::string filename)
 			}
 			m->characters.push_back(sh);
 		}
-        else if (std::string(entry->Value())== "empty")
+        else if (!strcmp(entry->Value(), "empty"))
 		{
 			m->charactercount++;
 			m->characters.push_back(0);
@@ -1276,264 +1279,175 @@ bool AptFile::XMLToApt(std::string filename)
 
 	data->aptdataoffset = GenerateAptAptFile(m, aptfile.string().c_str());
 	GenerateAptConstFile(data, constfile.string().c_str());
+	if (data->deduplicate)
+	{
+		std::cout << "Merged " << data->duplicatecount << " duplicate string constants, "
+			<< data->itemcount << " constants written, " << data->savedbytes << " bytes saved" << std::endl;
+	}
 	return true;
 }
 
 
 #pragma region Aptutils
-unsigned int AptFile::GetFrameItemSize(Frame *fr)
+uint32_t AptFile::GetFrameItemType(const char* name)
 {
-	unsigned int framesize = 0;
-	for (unsigned int i = 0; i < fr->frameitemcount; i++)
+	//frame item names are matched case insensitively, 0 if the name is unknown
+	switch (HashNameNoCase(name))
 	{
-		framesize += 4;
-		switch (fr->frameitems[i]->type)
-		{
-		case ACTION:
-			framesize += sizeof(OutputAction);
-			break;
-		case FRAMELABEL:
-			framesize += sizeof(FrameLabel);
-			break;
-		case PLACEOBJECT:
-			framesize += sizeof(PlaceObject);
-			break;
-		case REMOVEOBJECT:
-			framesize += sizeof(RemoveObject);
-			break;
-		case BACKGROUNDCOLOR:
-			framesize += sizeof(BackgroundColor);
-			break;
-		case INITACTION:
-			framesize += sizeof(OutputInitAction);
-			break;
-		}
+	case HashName("action"):
+		return _stricmp(name, "action") ? 0 : ACTION;
+	case HashName("framelabel"):
+		return _stricmp(name, "framelabel") ? 0 : FRAMELABEL;
+	case HashName("placeobject"):
+		return _stricmp(name, "placeobject") ? 0 : PLACEOBJECT;
+	case HashName("removeobject"):
+		return _stricmp(name, "removeobject") ? 0 : REMOVEOBJECT;
+	case HashName("background"):
+		return _stricmp(name, "background") ? 0 : BACKGROUNDCOLOR;
+	case HashName("initaction"):
+		return _stricmp(name, "initaction") ? 0 : INITACTION;
+	default:
+		return 0;
 	}
-	return framesize;
 }
 
-unsigned int AptFile::GetFrameItemPointerSize(Frame *fr)
+unsigned int AptFile::GetActionBytesSize(ActionHelper::ActionBytes &ab)
 {
-	unsigned int framesize = 0;
-	for (unsigned int i = 0; i < fr->frameitemcount; i++)
+	return ab.actionbytecount + GETALIGN(ab.actionbytecount);
+}
+
+unsigned int AptFile::GetActionDataSize(ActionHelper::ActionBytes &ab)
+{
+	unsigned int datasize = ab.constantcount * 4;
+	for (unsigned int j = 0; j < ab.stringcount; j++)
 	{
-		switch (fr->frameitems[i]->type)
-		{
-		case ACTION:
-		{
-			Action *a = ((Action *)fr->frameitems[i]);
-			framesize += a->ab.actionbytecount;
-			framesize += GETALIGN(a->ab.actionbytecount);
-		}
-			break;
-		case FRAMELABEL:
-		{
-			FrameLabel *f = ((FrameLabel *)fr->frameitems[i]);
-			framesize += STRLENGTH(f->label);
-		}
-			break;
-		case PLACEOBJECT:
+		datasize += STRLENGTH(ab.actionstrings[j]->string);
+	}
+	for (unsigned int j = 0; j < ab.pushdatacount; j++)
+	{
+		datasize += ab.actionpushdatas[j]->pushdatacount * 4;
+	}
+	for (unsigned int j = 0; j < ab.definefunction2count; j++)
+	{
+		for (unsigned int arg = 0; arg < ab.actiondefinefunction2s[j]->argumentcount; arg++)
 		{
-			PlaceObject *pl = ((PlaceObject *)fr->frameitems[i]);
-			if (pl->name)
-			{
-				framesize += STRLENGTH(pl->name);
-			}
-			if (pl->poa)
-			{
-				framesize += sizeof(OutputPlaceObjectActions);
-			}
+			datasize += 8;
+			datasize += STRLENGTH(ab.actiondefinefunction2s[j]->arguments[arg]->name);
 		}
-			break;
-		case INITACTION:
+	}
+	for (unsigned int j = 0; j < ab.definefunctioncount; j++)
+	{
+		for (unsigned int arg = 0; arg < ab.actiondefinefunctions[j]->argumentcount; arg++)
 		{
-			InitAction *a = ((InitAction *)fr->frameitems[i]);
-			framesize += a->ab.actionbytecount;
-			framesize += GETALIGN(a->ab.actionbytecount);
-		}
-			break;
+			datasize += 4;
+			datasize += STRLENGTH(ab.actiondefinefunctions[j]->arguments[arg]);
 		}
 	}
-	return framesize;
+	return datasize;
 }
 
-unsigned int AptFile::GetFrameItemPointerPointerSize(Frame *fr)
+//add the size of every section used by a frame, walking its frame items once
+void AptFile::PlanFrame(Frame *fr, LayoutPlan &plan)
 {
-	unsigned int framesize = 0;
+	plan.aptdatasize += 8;
+	plan.framesize += 8;
+	if (!fr)
+	{
+		return;
+	}
+	plan.frameitemlistsize += fr->frameitemcount * 4;
+	unsigned int itemsize = 0;
+	unsigned int pointersize = 0;
+	unsigned int pointerpointersize = 0;
+	unsigned int pointerpointerpointersize = 0;
+	unsigned int remainingsize = 0;
 	for (unsigned int i = 0; i < fr->frameitemcount; i++)
 	{
+		//4 more bytes are reserved for every frame item, as they always were
+		itemsize += 4;
 		switch (fr->frameitems[i]->type)
 		{
 		case ACTION:
 		{
 			Action *a = ((Action *)fr->frameitems[i]);
-			framesize += a->ab.constantcount * 4;
-			for (unsigned int j = 0; j < a->ab.stringcount; j++)
-			{
-				framesize += STRLENGTH(a->ab.actionstrings[j]->string);
-			}
-			for (unsigned int j = 0; j < a->ab.pushdatacount; j++)
-			{
-				framesize += a->ab.actionpushdatas[j]->pushdatacount * 4;
-			}
-			for (unsigned int j = 0; j < a->ab.definefunction2count; j++)
-			{
-				for (unsigned int arg = 0; arg < a->ab.actiondefinefunction2s[j]->argumentcount; arg++)
-				{
-					framesize += 8;
-					framesize += STRLENGTH(a->ab.actiondefinefunction2s[j]->arguments[arg]->name);
-				}
-			}
-			for (unsigned int j = 0; j < a->ab.definefunctioncount; j++)
-			{
-				for (unsigned int arg = 0; arg < a->ab.actiondefinefunctions[j]->argumentcount; arg++)
-				{
-					framesize += 4;
-					framesize += STRLENGTH(a->ab.actiondefinefunctions[j]->arguments[arg]);
-				}
-			}
-		}
-			break;
-		case PLACEOBJECT:
-		{
-			PlaceObject *pl = ((PlaceObject *)fr->frameitems[i]);
-			if (pl->poa)
-			{
-				framesize += pl->poa->clipactioncount * sizeof(PlaceObjectAction);
-			}
+			itemsize += sizeof(OutputAction);
+			pointersize += GetActionBytesSize(a->ab);
+			pointerpointersize += GetActionDataSize(a->ab);
 		}
 			break;
-		case INITACTION:
+		case FRAMELABEL:
 		{
-			InitAction *a = ((InitAction *)fr->frameitems[i]);
-			framesize += a->ab.constantcount * 4;
-			for (unsigned int j = 0; j < a->ab.stringcount; j++)
-			{
-				framesize += STRLENGTH(a->ab.actionstrings[j]->string);
-			}
-			for (unsigned int j = 0; j < a->ab.pushdatacount; j++)
-			{
-				framesize += a->ab.actionpushdatas[j]->pushdatacount * 4;
-			}
-			for (unsigned int j = 0; j < a->ab.definefunction2count; j++)
-			{
-				for (unsigned int arg = 0; arg < a->ab.actiondefinefunction2s[j]->argumentcount; arg++)
-				{
-					framesize += 8;
-					framesize += STRLENGTH(a->ab.actiondefinefunction2s[j]->arguments[arg]->name);
-				}
-			}
-			for (unsigned int j = 0; j < a->ab.definefunctioncount; j++)
-			{
-				for (unsigned int arg = 0; arg < a->ab.actiondefinefunctions[j]->argumentcount; arg++)
-				{
-					framesize += 4;
-					framesize += STRLENGTH(a->ab.actiondefinefunctions[j]->arguments[arg]);
-				}
-			}
+			FrameLabel *f = ((FrameLabel *)fr->frameitems[i]);
+			itemsize += sizeof(FrameLabel);
+			pointersize += STRLENGTH(f->label);
 		}
 			break;
-		}
-	}
-	return framesize;
-}
-
-unsigned int AptFile::GetFrameItemPointerPointerPointerSize(Frame *fr)
-{
-	unsigned int framesize = 0;
-	for (unsigned int i = 0; i < fr->frameitemcount; i++)
-	{
-		switch (fr->frameitems[i]->type)
-		{
 		case PLACEOBJECT:
 		{
 			PlaceObject *pl = ((PlaceObject *)fr->frameitems[i]);
+			itemsize += sizeof(PlaceObject);
+			if (pl->name)
+			{
+				pointersize += STRLENGTH(pl->name);
+			}
 			if (pl->poa)
 			{
+				pointersize += sizeof(OutputPlaceObjectActions);
+				pointerpointersize += pl->poa->clipactioncount * sizeof(PlaceObjectAction);
 				for (unsigned int j = 0; j < pl->poa->clipactioncount; j++)
 				{
-					framesize += pl->poa->actions[j]->actiondata->ab.actionbytecount;
-					framesize += GETALIGN(pl->poa->actions[j]->actiondata->ab.actionbytecount);
+					pointerpointerpointersize += GetActionBytesSize(pl->poa->actions[j]->actiondata->ab);
+					remainingsize += GetActionDataSize(pl->poa->actions[j]->actiondata->ab);
 				}
 			}
 		}
 			break;
-		}
-	}
-	return framesize;
-}
-
-unsigned int AptFile::GetFrameItemPointerPointerPointerPointerSize(Frame *fr)
-{
-	unsigned int framesize = 0;
-	for (unsigned int i = 0; i < fr->frameitemcount; i++)
-	{
-		switch (fr->frameitems[i]->type)
-		{
-		case PLACEOBJECT:
+		case REMOVEOBJECT:
+			itemsize += sizeof(RemoveObject);
+			break;
+		case BACKGROUNDCOLOR:
+			itemsize += sizeof(BackgroundColor);
+			break;
+		case INITACTION:
 		{
-			PlaceObject *pl = ((PlaceObject *)fr->frameitems[i]);
-			if (pl->poa)
-			{
-				for (unsigned int j = 0; j < pl->poa->clipactioncount; j++)
-				{
-					framesize += pl->poa->actions[j]->actiondata->ab.constantcount * 4;
-					for (unsigned int k = 0; k < pl->poa->actions[j]->actiondata->ab.stringcount; k++)
-					{
-						framesize += STRLENGTH(pl->poa->actions[j]->actiondata->ab.actionstrings[k]->string);
-					}
-					for (unsigned int k = 0; k < pl->poa->actions[j]->actiondata->ab.pushdatacount; k++)
-					{
-						framesize += pl->poa->actions[j]->actiondata->ab.actionpushdatas[k]->pushdatacount * 4;
-					}
-					for (unsigned int k = 0; k < pl->poa->actions[j]->actiondata->ab.definefunction2count; k++)
-					{
-						for (unsigned int arg = 0; arg < pl->poa->actions[j]->actiondata->ab.actiondefinefunction2s[k]->argumentcount; arg++)
-						{
-							framesize += 8;
-							framesize += STRLENGTH(pl->poa->actions[j]->actiondata->ab.actiondefinefunction2s[k]->arguments[arg]->name);
-						}
-					}
-					for (unsigned int k = 0; k < pl->poa->actions[j]->actiondata->ab.definefunctioncount; k++)
-					{
-						for (unsigned int arg = 0; arg < pl->poa->actions[j]->actiondata->ab.actiondefinefunctions[k]->argumentcount; arg++)
-						{
-							framesize += 4;
-							framesize += STRLENGTH(pl->poa->actions[j]->actiondata->ab.actiondefinefunctions[k]->arguments[arg]);
-						}
-					}
-				}
-			}
+			InitAction *a = ((InitAction *)fr->frameitems[i]);
+			itemsize += sizeof(OutputInitAction);
+			pointersize += GetActionBytesSize(a->ab);
+			pointerpointersize += GetActionDataSize(a->ab);
 		}
 			break;
 		}
 	}
-	return framesize;
+	plan.frameitemsize += itemsize;
+	plan.frameitempointersize += pointersize;
+	plan.frameitempointerpointersize += pointerpointersize;
+	plan.frameitempointerpointerpointersize += pointerpointerpointersize;
+	plan.aptdatasize += fr->frameitemcount * 4 + itemsize + pointersize + pointerpointersize
+		+ pointerpointerpointersize + remainingsize;
 }
 
 uint32_t AptFile::GenerateAptAptFile(Movie *m, const char *filename)
 {
 	uint32_t result = 0;
-	unsigned int aptdatasize = 16;
-	unsigned int characterdatasize = 0;
-	unsigned int framesize = 0;
-	unsigned int frameitemlistsize = 0;
-	unsigned int frameitemsize = 0;
-	unsigned int frameitempointersize = 0;
-	unsigned int frameitempointerpointersize = 0;
-	unsigned int frameitempointerpointerpointersize = 0;
+	//first pass: the size of every section, then the output is written in a second pass
+	LayoutPlan plan;
 	for (unsigned int i = 0; i < m->importcount; i++)
 	{
-		aptdatasize += sizeof(Import);
-		aptdatasize += STRLENGTH(m->imports[i]->movie);
-		aptdatasize += STRLENGTH(m->imports[i]->name);
+		plan.aptdatasize += sizeof(Import);
+		plan.charactertable += sizeof(Import);
+		plan.aptdatasize += STRLENGTH(m->imports[i]->movie);
+		plan.charactertable += STRLENGTH(m->imports[i]->movie);
+		plan.aptdatasize += STRLENGTH(m->imports[i]->name);
+		plan.charactertable += STRLENGTH(m->imports[i]->name);
 	}
 	for (unsigned int i = 0; i < m->exportcount; i++)
 	{
-		aptdatasize += sizeof(Export);
-		aptdatasize += STRLENGTH(m->exports[i]->name);
+		plan.aptdatasize += sizeof(Export);
+		plan.charactertable += sizeof(Export);
+		plan.aptdatasize += STRLENGTH(m->exports[i]->name);
+		plan.charactertable += STRLENGTH(m->exports[i]->name);
 	}
-	aptdatasize += m->charactercount * 4;
+	plan.aptdatasize += m->charactercount * 4;
 	for (unsigned int i = 0; i < m->charactercount; i++)
 	{
 		if (m->characters[i])
@@ -1542,164 +1456,97 @@ uint32_t AptFile::GenerateAptAptFile(Movie *m, const char *filename)
 			{
 			case BUTTON:
 			{
-				aptdatasize += sizeof(OutputButton);
-				characterdatasize += sizeof(OutputButton);
+				plan.aptdatasize += sizeof(OutputButton);
+				plan.characterdatasize += sizeof(OutputButton);
 				Button *b = (Button *)m->characters[i];
-				frameitemsize += b->vertexcount * sizeof(Vector2);
-				aptdatasize += b->vertexcount * sizeof(Vector2);
-				frameitemsize += b->trianglecount * sizeof(Triangle);
-				aptdatasize += b->trianglecount * sizeof(Triangle);
-				frameitemsize += GETALIGN(b->trianglecount * sizeof(Triangle));
-				aptdatasize += GETALIGN(b->trianglecount * sizeof(Triangle));
-				frameitemsize += b->recordcount * sizeof(ButtonRecord);
-				aptdatasize += b->recordcount * sizeof(ButtonRecord);
-				frameitemsize += b->buttonactioncount * sizeof(OutputButtonAction);
-				aptdatasize += b->buttonactioncount * sizeof(OutputButtonAction);
+				unsigned int fisize = b->vertexcount * sizeof(Vector2);
+				fisize += b->trianglecount * sizeof(Triangle);
+				fisize += GETALIGN(b->trianglecount * sizeof(Triangle));
+				fisize += b->recordcount * sizeof(ButtonRecord);
+				fisize += b->buttonactioncount * sizeof(OutputButtonAction);
 				unsigned int fipsize = 0;
 				unsigned int fippsize = 0;
 				for (unsigned int bu = 0; bu < b->buttonactioncount; bu++)
 				{
-					fipsize += b->buttonactionrecords[bu]->actiondata->ab.actionbytecount;
-					fipsize += GETALIGN(b->buttonactionrecords[bu]->actiondata->ab.actionbytecount);
-					fippsize += b->buttonactionrecords[bu]->actiondata->ab.constantcount * 4;
-					for (unsigned int j = 0; j < b->buttonactionrecords[bu]->actiondata->ab.stringcount; j++)
-					{
-						fippsize += STRLENGTH(b->buttonactionrecords[bu]->actiondata->ab.actionstrings[j]->string);
-					}
-					for (unsigned int j = 0; j < b->buttonactionrecords[bu]->actiondata->ab.pushdatacount; j++)
-					{
-						fippsize += b->buttonactionrecords[bu]->actiondata->ab.actionpushdatas[j]->pushdatacount * 4;
-					}
-					for (unsigned int j = 0; j < b->buttonactionrecords[bu]->actiondata->ab.definefunction2count; j++)
-					{
-						for (unsigned int arg = 0; arg < b->buttonactionrecords[bu]->actiondata->ab.actiondefinefunction2s[j]->argumentcount; arg++)
-						{
-							fippsize += 8;
-							fippsize += STRLENGTH(b->buttonactionrecords[bu]->actiondata->ab.actiondefinefunction2s[j]->arguments[arg]->name);
-						}
-					}
-					for (unsigned int j = 0; j < b->buttonactionrecords[bu]->actiondata->ab.definefunctioncount; j++)
-					{
-						for (unsigned int arg = 0; arg < b->buttonactionrecords[bu]->actiondata->ab.actiondefinefunctions[j]->argumentcount; arg++)
-						{
-							fippsize += 4;
-							fippsize += STRLENGTH(b->buttonactionrecords[bu]->actiondata->ab.actiondefinefunctions[j]->arguments[arg]);
-						}
-					}
+					fipsize += GetActionBytesSize(b->buttonactionrecords[bu]->actiondata->ab);
+					fippsize += GetActionDataSize(b->buttonactionrecords[bu]->actiondata->ab);
 				}
-				frameitempointersize += fipsize;
-				aptdatasize += fipsize;
-				frameitempointerpointersize += fippsize;
-				aptdatasize += fippsize;
+				plan.frameitemsize += fisize;
+				plan.frameitempointersize += fipsize;
+				plan.frameitempointerpointersize += fippsize;
+				plan.aptdatasize += fisize + fipsize + fippsize;
 			}
 				break;
 			case SHAPE:
-				aptdatasize += sizeof(Shape);
-				characterdatasize += sizeof(Shape);
+				plan.aptdatasize += sizeof(Shape);
+				plan.characterdatasize += sizeof(Shape);
 				break;
 			case EDITTEXT:
-				aptdatasize += sizeof(EditText);
-				characterdatasize += sizeof(EditText);
+				plan.aptdatasize += sizeof(EditText);
+				plan.characterdatasize += sizeof(EditText);
 				if (((EditText *)m->characters[i])->text)
 				{
-					aptdatasize += STRLENGTH(((EditText *)m->characters[i])->text);
-					framesize += STRLENGTH(((EditText *)m->characters[i])->text);
+					plan.aptdatasize += STRLENGTH(((EditText *)m->characters[i])->text);
+					plan.framesize += STRLENGTH(((EditText *)m->characters[i])->text);
 				}
 				if (((EditText *)m->characters[i])->variable)
 				{
-					aptdatasize += STRLENGTH(((EditText *)m->characters[i])->variable);
-					framesize += STRLENGTH(((EditText *)m->characters[i])->variable);
+					plan.aptdatasize += STRLENGTH(((EditText *)m->characters[i])->variable);
+					plan.framesize += STRLENGTH(((EditText *)m->characters[i])->variable);
 				}
 				break;
 			case FONT:
-				aptdatasize += sizeof(OutputFont);
-				characterdatasize += sizeof(OutputFont);
-				aptdatasize += STRLENGTH(((Font *)m->characters[i])->name);
-				framesize += STRLENGTH(((Font *)m->characters[i])->name);
-				aptdatasize += ((Font *)m->characters[i])->glyphcount * 4;
-				framesize += ((Font *)m->characters[i])->glyphcount * 4;
+				plan.aptdatasize += sizeof(OutputFont);
+				plan.characterdatasize += sizeof(OutputFont);
+				plan.aptdatasize += STRLENGTH(((Font *)m->characters[i])->name);
+				plan.framesize += STRLENGTH(((Font *)m->characters[i])->name);
+				plan.aptdatasize += ((Font *)m->characters[i])->glyphcount * 4;
+				plan.framesize += ((Font *)m->characters[i])->glyphcount * 4;
 				break;
 			case SPRITE:
-				aptdatasize += sizeof(OutputSprite);
-				characterdatasize += sizeof(OutputSprite);
+				plan.aptdatasize += sizeof(OutputSprite);
+				plan.characterdatasize += sizeof(OutputSprite);
 				for (unsigned int j = 0; j < ((Sprite *)m->characters[i])->framecount; j++)
 				{
-					aptdatasize += 8;
-					framesize += 8;
-					if (((Sprite *)m->characters[i])->frames[j])
-					{
-						frameitemlistsize += ((Sprite *)m->characters[i])->frames[j]->frameitemcount * 4;
-						aptdatasize += ((Sprite *)m->characters[i])->frames[j]->frameitemcount * 4;
-						int frsize = GetFrameItemSize(((Sprite *)m->characters[i])->frames[j]);
-						aptdatasize += frsize;
-						frameitemsize += frsize;
-						int frpsize = GetFrameItemPointerSize(((Sprite *)m->characters[i])->frames[j]);
-						aptdatasize += frpsize;
-						frameitempointersize += frpsize;
-						int frppsize = GetFrameItemPointerPointerSize(((Sprite *)m->characters[i])->frames[j]);
-						aptdatasize += frppsize;
-						frameitempointerpointersize += frppsize;
-						int frpppsize = GetFrameItemPointerPointerPointerSize(((Sprite *)m->characters[i])->frames[j]);
-						aptdatasize += frpppsize;
-						frameitempointerpointerpointersize += frpppsize;
-						aptdatasize += GetFrameItemPointerPointerPointerPointerSize(((Sprite *)m->characters[i])->frames[j]);
-					}
+					PlanFrame(((Sprite *)m->characters[i])->frames[j], plan);
 				}
 				break;
 			case IMAGE:
-				aptdatasize += sizeof(Image);
-				characterdatasize += sizeof(Image);
+				plan.aptdatasize += sizeof(Image);
+				plan.characterdatasize += sizeof(Image);
 				break;
 			case MORPH:
-				aptdatasize += sizeof(Morph);
-				characterdatasize += sizeof(Morph);
+				plan.aptdatasize += sizeof(Morph);
+				plan.characterdatasize += sizeof(Morph);
 				break;
 			case MOVIE:
-				aptdatasize += sizeof(OutputMovie);
-				characterdatasize += sizeof(OutputMovie);
+				plan.aptdatasize += sizeof(OutputMovie);
+				plan.characterdatasize += sizeof(OutputMovie);
 				for (unsigned int j = 0; j < ((Movie *)m->characters[i])->framecount; j++)
 				{
-					aptdatasize += 8;
-					framesize += 8;
-					if (((Movie *)m->characters[i])->frames[j])
-					{
-						frameitemlistsize += ((Movie *)m->characters[i])->frames[j]->frameitemcount * 4;
-						aptdatasize += ((Movie *)m->characters[i])->frames[j]->frameitemcount * 4;
-						int frsize = GetFrameItemSize(((Movie *)m->characters[i])->frames[j]);
-						aptdatasize += frsize;
-						frameitemsize += frsize;
-						int frpsize = GetFrameItemPointerSize(((Movie *)m->characters[i])->frames[j]);
-						aptdatasize += frpsize;
-						frameitempointersize += frpsize;
-						int frppsize = GetFrameItemPointerPointerSize(((Movie *)m->characters[i])->frames[j]);
-						aptdatasize += frppsize;
-						frameitempointerpointersize += frppsize;
-						int frpppsize = GetFrameItemPointerPointerPointerSize(((Movie *)m->characters[i])->frames[j]);
-						aptdatasize += frpppsize;
-						frameitempointerpointerpointersize += frpppsize;
-						aptdatasize += GetFrameItemPointerPointerPointerPointerSize(((Movie *)m->characters[i])->frames[j]);
-					}
+					PlanFrame(((Movie *)m->characters[i])->frames[j], plan);
 				}
 				break;
 			case TEXT:
 			{
-				aptdatasize += sizeof(OutputText);
-				characterdatasize += sizeof(OutputText);
+				plan.aptdatasize += sizeof(OutputText);
+				plan.characterdatasize += sizeof(OutputText);
 				Text *t = (Text *)m->characters[i];
-				frameitemsize += t->recordcount * sizeof(OutputTextRecord);
-				aptdatasize += t->recordcount * sizeof(OutputTextRecord);
+				plan.frameitemsize += t->recordcount * sizeof(OutputTextRecord);
+				plan.aptdatasize += t->recordcount * sizeof(OutputTextRecord);
 				unsigned int fipsize = 0;
 				for (unsigned int te = 0; te < t->recordcount; te++)
 				{
 					fipsize += t->records[te]->glyphcount * sizeof(Glyph);
 				}
-				frameitempointersize += fipsize;
-				aptdatasize += fipsize;
+				plan.frameitempointersize += fipsize;
+				plan.aptdatasize += fipsize;
 			}
 				break;
 			}
 		}
 	}
+	const unsigned int aptdatasize = plan.aptdatasize;
 	unsigned char *aptdata = new unsigned char[aptdatasize];
 	memset(aptdata, 0, aptdatasize);
 	unsigned char *aptpos = aptdata;
@@ -1734,19 +1581,19 @@ uint32_t AptFile::GenerateAptAptFile(Movie *m, const char *filename)
 	unsigned char **ch = (unsigned char **)aptpos;
 	aptpos += m->charactercount * 4;
 	unsigned char *chd = aptpos;
-	aptpos += characterdatasize;
+	aptpos += plan.characterdatasize;
 	OutputFrame *fr = (OutputFrame *)aptpos;
-	aptpos += framesize;
+	aptpos += plan.framesize;
 	unsigned char **fil = (unsigned char **)aptpos;
-	aptpos += frameitemlistsize;
+	aptpos += plan.frameitemlistsize;
 	unsigned char *fi = aptpos;
-	aptpos += frameitemsize;
+	aptpos += plan.frameitemsize;
 	unsigned char *fip = aptpos;
-	aptpos += frameitempointersize;
+	aptpos += plan.frameitempointersize;
 	unsigned char *ads = aptpos;
-	aptpos += frameitempointerpointersize;
+	aptpos += plan.frameitempointerpointersize;
 	unsigned char *ads2 = aptpos;
-	aptpos += frameitempointerpointerpointersize;
+	aptpos += plan.frameitempointerpointerpointersize;
 	unsigned char *ads3 = aptpos;
 	for (unsigned int i = 0; i < m->charactercount; i++)
 	{
@@ -1818,11 +1665,9 @@ uint32_t AptFile::GenerateAptAptFile(Movie *m, const char *filename)
 						a->flags = ba->flags;
 						Action *ai = ba->actiondata;
 						relocations.push_back((unsigned char **)(&a->actiondata));
-						std::string s = ai->ab.actionbytes.str();
-						const char *sc = s.c_str();
 						a->actiondata = fip;
 						unsigned char *abcs = fip;
-						memcpy(fip, sc, ai->ab.actionbytecount);
+						memcpy(fip, ai->ab.actionbytes.data(), ai->ab.actionbytecount);
 						fip += ai->ab.actionbytecount;
 						fip += GETALIGN(ai->ab.actionbytecount);
 						if (ai->ab.constantcount)
@@ -2015,11 +1860,9 @@ uint32_t AptFile::GenerateAptAptFile(Movie *m, const char *filename)
 								fi += sizeof(OutputAction);
 								a->type = ai->type;
 								relocations.push_back((unsigned char **)(&a->actionbytes));
-								std::string s = ai->ab.actionbytes.str();
-								const char *sc = s.c_str();
 								a->actionbytes = fip;
 								unsigned char *abcs = fip;
-								memcpy(fip, sc, ai->ab.actionbytecount);
+								memcpy(fip, ai->ab.actionbytes.data(), ai->ab.actionbytecount);
 								fip += ai->ab.actionbytecount;
 								fip += GETALIGN(ai->ab.actionbytecount);
 								if (ai->ab.constantcount)
@@ -2141,9 +1984,7 @@ uint32_t AptFile::GenerateAptAptFile(Movie *m, const char *filename)
 										unsigned char *abcs = ads2;
 										ads2 += pli->poa->actions[l]->actiondata->ab.actionbytecount;
 										ads2 += GETALIGN(pli->poa->actions[l]->actiondata->ab.actionbytecount);
-										std::string s = pli->poa->actions[l]->actiondata->ab.actionbytes.str();
-										const char *sc = s.c_str();
-										memcpy(abcs, sc, pli->poa->actions[l]->actiondata->ab.actionbytecount);
+										memcpy(abcs, pli->poa->actions[l]->actiondata->ab.actionbytes.data(), pli->poa->actions[l]->actiondata->ab.actionbytecount);
 										if (pli->poa->actions[l]->actiondata->ab.constantcount)
 										{
 											*(unsigned char **)(abcs + 8) = ads3;
@@ -2237,11 +2078,9 @@ uint32_t AptFile::GenerateAptAptFile(Movie *m, const char *filename)
 								a->type = ai->type;
 								a->sprite = ai->sprite;
 								relocations.push_back((unsigned char **)(&a->actionbytes));
-								std::string s = ai->ab.actionbytes.str();
-								const char *sc = s.c_str();
 								a->actionbytes = fip;
 								unsigned char *abcs = fip;
-								memcpy(fip, sc, ai->ab.actionbytecount);
+								memcpy(fip, ai->ab.actionbytes.data(), ai->ab.actionbytecount);
 								fip += ai->ab.actionbytecount;
 								fip += GETALIGN(ai->ab.actionbytecount);
 								if (ai->ab.constantcount)
@@ -2405,11 +2244,9 @@ uint32_t AptFile::GenerateAptAptFile(Movie *m, const char *filename)
 								fi += sizeof(OutputAction);
 								a->type = ai->type;
 								relocations.push_back((unsigned char **)(&a->actionbytes));
-								std::string s = ai->ab.actionbytes.str();
-								const char *sc = s.c_str();
 								a->actionbytes = fip;
 								unsigned char *abcs = fip;
-								memcpy(fip, sc, ai->ab.actionbytecount);
+								memcpy(fip, ai->ab.actionbytes.data(), ai->ab.actionbytecount);
 								fip += ai->ab.actionbytecount;
 								fip += GETALIGN(ai->ab.actionbytecount);
 								if (ai->ab.constantcount)
@@ -2531,9 +2368,7 @@ uint32_t AptFile::GenerateAptAptFile(Movie *m, const char *filename)
 										unsigned char *abcs = ads2;
 										ads2 += pli->poa->actions[l]->actiondata->ab.actionbytecount;
 										ads2 += GETALIGN(pli->poa->actions[l]->actiondata->ab.actionbytecount);
-										std::string s = pli->poa->actions[l]->actiondata->ab.actionbytes.str();
-										const char *sc = s.c_str();
-										memcpy(abcs, sc, pli->poa->actions[l]->actiondata->ab.actionbytecount);
+										memcpy(abcs, pli->poa->actions[l]->actiondata->ab.actionbytes.data(), pli->poa->actions[l]->actiondata->ab.actionbytecount);
 										if (pli->poa->actions[l]->actiondata->ab.constantcount)
 										{
 											*(unsigned char **)(abcs + 8) = ads3;
@@ -2628,11 +2463,9 @@ uint32_t AptFile::GenerateAptAptFile(Movie *m, const char *filename)
 								a->type = ai->type;
 								a->sprite = ai->sprite;
 								relocations.push_back((unsigned char **)(&a->actionbytes));
-								std::string s = ai->ab.actionbytes.str();
-								const char *sc = s.c_str();
 								a->actionbytes = fip;
 								unsigned char *abcs = fip;
-								memcpy(fip, sc, ai->ab.actionbytecount);
+								memcpy(fip, ai->ab.actionbytes.data(), ai->ab.actionbytecount);
 								fip += ai->ab.actionbytecount;
 								fip += GETALIGN(ai->ab.actionbytecount);
 								if (ai->ab.constantcount)
@@ -2767,20 +2600,8 @@ uint32_t AptFile::GenerateAptAptFile(Movie *m, const char *filename)
 		return -1;
 	}
 
-	//calculate the const offset
-	unsigned int offset = 12;
-	for (unsigned int i = 0; i < m->importcount; ++i)
-	{
-		offset += sizeof(Import);
-		offset += STRLENGTH(m->imports[i]->movie);
-		offset += STRLENGTH(m->imports[i]->name);
-	}
-	for (unsigned int i = 0; i < m->exportcount; ++i)
-	{
-		offset += sizeof(Export);
-		offset += STRLENGTH(m->exports[i]->name);
-	}
-	result = *(uint32_t*)(aptdata + offset);
+	//the const offset is the first entry of the character table, which is the movie itself
+	result = *(uint32_t*)(aptdata + plan.charactertable);
 
 
 	fwrite(aptdata, aptdatasize, 1, f);
@@ -444,17 +444,29 @@ private:
 #pragma endregion
 
 public:
-	DLL_EXPORT static bool Convert(std::string filename);
+	DLL_EXPORT static bool Convert(std::string filename, bool dedupconstants = false);
 	DLL_EXPORT static bool AptToXML(std::string filename);
-	DLL_EXPORT static bool XMLToApt(std::string filename);
+	DLL_EXPORT static bool XMLToApt(std::string filename, bool dedupconstants = false);
 
 private:
+	//size of each section of the generated .apt file
+	struct LayoutPlan {
+		unsigned int aptdatasize = 16;
+		unsigned int charactertable = 12; //offset of the character pointers
+		unsigned int characterdatasize = 0;
+		unsigned int framesize = 0;
+		unsigned int frameitemlistsize = 0;
+		unsigned int frameitemsize = 0;
+		unsigned int frameitempointersize = 0;
+		unsigned int frameitempointerpointersize = 0;
+		unsigned int frameitempointerpointerpointersize = 0;
+	};
+
 	//Util functions
-	static unsigned int GetFrameItemSize(Frame* fr);
-	static unsigned int AptFile::GetFrameItemPointerSize(Frame* fr);
-	static unsigned int AptFile::GetFrameItemPointerPointerSize(Frame* fr);
-	static unsigned int AptFile::GetFrameItemPointerPointerPointerSize(Frame* fr);
-	static unsigned int AptFile::GetFrameItemPointerPointerPointerPointerSize(Frame* fr);
+	static uint32_t GetFrameItemType(const char* name);
+	static unsigned int GetActionBytesSize(ActionHelper::ActionBytes& ab);
+	static unsigned int GetActionDataSize(ActionHelper::ActionBytes& ab);
+	static void PlanFrame(Frame* fr, LayoutPlan& plan);
 	static uint32_t GenerateAptAptFile(Movie* m, const char* filename);
 	static void GenerateAptConstFile(AptConstData* c, const char* filename);  
 };
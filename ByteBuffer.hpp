@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// growable contiguous byte buffer, values are always appended as little endian
+class ByteBuffer {
+public:
+    template <typename T>
+    void append(const T value) {
+        static_assert(std::is_arithmetic_v<T> or std::is_enum_v<T>);
+        using Unsigned = std::conditional_t<
+            sizeof(T) == 1, std::uint8_t,
+            std::conditional_t<sizeof(T) == 2, std::uint16_t,
+                               std::conditional_t<sizeof(T) == 4, std::uint32_t,
+                                                  std::uint64_t>>>;
+        static_assert(sizeof(Unsigned) == sizeof(T));
+        auto bits = Unsigned{};
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        const auto offset = this->bytes.size();
+        this->bytes.resize(offset + sizeof(bits));
+        for (auto i = std::size_t{ 0 }; i < sizeof(bits); ++i) {
+            this->bytes[offset + i] = static_cast<std::uint8_t>(bits >> (8 * i));
+        }
+    }
+
+    void appendBytes(const void* source, const std::size_t length) {
+        const auto* begin = static_cast<const std::uint8_t*>(source);
+        this->bytes.insert(this->bytes.end(), begin, begin + length);
+    }
+
+    void appendZeros(const std::size_t length) {
+        this->bytes.resize(this->bytes.size() + length, 0);
+    }
+
+    // pad with zeros until size() is a multiple of alignment
+    std::size_t alignTo(const std::size_t alignment) {
+        const auto padding = (alignment - this->bytes.size() % alignment) % alignment;
+        this->appendZeros(padding);
+        return padding;
+    }
+
+    void reserve(const std::size_t capacity) { this->bytes.reserve(capacity); }
+    void clear() noexcept { this->bytes.clear(); }
+
+    const std::uint8_t* data() const noexcept { return this->bytes.data(); }
+    std::size_t size() const noexcept { return this->bytes.size(); }
+
+    std::string_view view() const noexcept {
+        return { reinterpret_cast<const char*>(this->bytes.data()), this->bytes.size() };
+    }
+
+private:
+    std::vector<std::uint8_t> bytes;
+};
@@ -1,5 +1,7 @@
 #pragma once
 #include "Util.hpp"
+#include <string_view>
+#include <unordered_map>
 
 namespace Constfile
 {
@@ -21,6 +23,11 @@ namespace Constfile
 		uint32_t aptdataoffset;
 		uint32_t itemcount;
 		std::vector<AptConstItem *> items;
+		//when set, identical strings share a single item (see ActionHelper::AddConstItem)
+		bool deduplicate = false;
+		std::unordered_map<std::string_view, uint32_t> stringitems;
+		uint32_t duplicatecount = 0;
+		uint32_t savedbytes = 0;
 	};
 
 }
\ No newline at end of file
@@ -1,5 +1,56 @@
 #include "Util.hpp"
 
+#if defined(_M_X64) or (defined(_M_IX86_FP) and _M_IX86_FP >= 2) or defined(__SSE2__)
+#include <emmintrin.h>
+#define UTIL_HAS_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+bool isXmlSpecial(const char character) noexcept {
+    return character == '&' or character == '\'' or character == '"' or character == '<' or
+           character == '>';
+}
+
+#ifdef UTIL_HAS_SSE2
+unsigned long countTrailingZeros(const unsigned int mask) noexcept {
+#ifdef _MSC_VER
+    auto index = 0ul;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned long>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+const char* findXmlSpecial(const char* current, const char* const end) noexcept {
+#ifdef UTIL_HAS_SSE2
+    const auto ampersand = _mm_set1_epi8('&');
+    const auto apostrophe = _mm_set1_epi8('\'');
+    const auto quote = _mm_set1_epi8('"');
+    const auto less = _mm_set1_epi8('<');
+    const auto greater = _mm_set1_epi8('>');
+    for (; end - current >= 16; current += 16) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current));
+        const auto found = _mm_or_si128(
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, ampersand),
+                                      _mm_cmpeq_epi8(block, apostrophe)),
+                         _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, less))),
+            _mm_cmpeq_epi8(block, greater));
+        if (const auto mask = static_cast<unsigned int>(_mm_movemask_epi8(found)); mask != 0) {
+            return current + countTrailingZeros(mask);
+        }
+    }
+#endif
+    return std::find_if(current, end, isXmlSpecial);
+}
+
+} // namespace
+
 std::string readEntireFile(const std::filesystem::path& filePath) {
 	auto result = std::string{};
 	const auto fileSize = std::filesystem::file_size(filePath);
@@ -22,6 +73,124 @@ std::string readEntireFile(const std::filesystem::path& filePath) {
     return result;
 }
 
+MappedFile::MappedFile(const std::filesystem::path& filePath) :
+    size{ static_cast<std::size_t>(std::filesystem::file_size(filePath)) } {
+    if (this->size == 0) {
+        // empty files cannot be mapped, and there is nothing to read anyway
+        return;
+    }
+    this->file = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (this->file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error{ "Failed to open file " + filePath.string() };
+    }
+    this->mapping = CreateFileMappingW(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const auto* view = this->mapping == nullptr
+                           ? nullptr
+                           : MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        // the destructor does not run for a constructor which throws
+        if (this->mapping != nullptr) {
+            CloseHandle(this->mapping);
+        }
+        CloseHandle(this->file);
+        throw std::runtime_error{ "Failed to map file " + filePath.string() +
+                                  " into memory" };
+    }
+    this->begin = static_cast<const char*>(view);
+}
+
+MappedFile::~MappedFile() {
+    if (this->begin != nullptr) {
+        UnmapViewOfFile(this->begin);
+    }
+    if (this->mapping != nullptr) {
+        CloseHandle(this->mapping);
+    }
+    if (this->file != INVALID_HANDLE_VALUE) {
+        CloseHandle(this->file);
+    }
+}
+
+bool isAllZero(const std::string_view data) noexcept {
+    auto current = data.data();
+    const auto end = data.data() + data.size();
+#ifdef UTIL_HAS_SSE2
+    const auto load = [](const char* position) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(position));
+    };
+    const auto isZero = [](const __m128i block) {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_setzero_si128())) == 0xFFFF;
+    };
+    for (; end - current >= 64; current += 64) {
+        const auto block = _mm_or_si128(_mm_or_si128(load(current), load(current + 16)),
+                                        _mm_or_si128(load(current + 32), load(current + 48)));
+        if (not isZero(block)) {
+            return false;
+        }
+    }
+    for (; end - current >= 16; current += 16) {
+        if (not isZero(load(current))) {
+            return false;
+        }
+    }
+#endif
+    return std::all_of(current, end, [](const char byte) { return byte == 0; });
+}
+
+void appendXmlEscaped(std::string& destination, const std::string_view source) {
+    auto current = source.data();
+    const auto end = source.data() + source.size();
+    while (true) {
+        const auto special = findXmlSpecial(current, end);
+        destination.append(current, special);
+        if (special == end) {
+            return;
+        }
+        switch (*special) {
+        case '&':
+            destination += "&amp;";
+            break;
+        case '\'':
+            destination += "&apos;";
+            break;
+        case '"':
+            destination += "&quot;";
+            break;
+        case '<':
+            destination += "&lt;";
+            break;
+        default:
+            destination += "&gt;";
+            break;
+        }
+        current = special + 1;
+    }
+}
+
+void byteSwapEach(char* data, const std::size_t size, const std::size_t width) noexcept {
+    auto current = data;
+    const auto end = data + size;
+#ifdef UTIL_HAS_SSE2
+    // SSE2 has no byte shuffle: swap the bytes of each 16 bit lane by shifting,
+    // for 32 bit values swap the two lanes first
+    if (width == 2 or width == 4) {
+        for (; end - current >= 16; current += 16) {
+            auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(current));
+            if (width == 4) {
+                block = _mm_shufflehi_epi16(_mm_shufflelo_epi16(block, _MM_SHUFFLE(2, 3, 0, 1)),
+                                            _MM_SHUFFLE(2, 3, 0, 1));
+            }
+            block = _mm_or_si128(_mm_slli_epi16(block, 8), _mm_srli_epi16(block, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(current), block);
+        }
+    }
+#endif
+    for (; current != end; current += width) {
+        std::reverse(current, current + width);
+    }
+}
+
 std::string_view trySplitFront(std::string_view& source, const std::string_view::size_type maxLength) noexcept {
     const auto splitted = source.substr(0, maxLength);
     source.remove_prefix(splitted.size());
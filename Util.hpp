@@ -1,10 +1,13 @@
 #pragma once
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <cstring>
 #include <ciso646>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <string_view>
 #include <stdint.h>
 #include <limits>
 #include <type_traits>
@@ -18,27 +21,111 @@
 #define B(x) x ? "true" : "false"
 #define add(x) *((uint8_t**)&x) += (uint32_t)aptbuffer;
 
+// FNV-1a; constexpr so element names can be used as case labels, where two
+// names with the same hash would fail to compile as duplicate labels
+constexpr uint32_t HashName(const std::string_view name) noexcept {
+    auto hash = uint32_t{ 2166136261u };
+    for (const auto c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+// same as HashName, but ASCII letters are hashed as lower case
+constexpr uint32_t HashNameNoCase(const std::string_view name) noexcept {
+    auto hash = uint32_t{ 2166136261u };
+    for (const auto c : name) {
+        const auto lower = (c >= 'A' and c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        hash = (hash ^ static_cast<uint8_t>(lower)) * 16777619u;
+    }
+    return hash;
+}
+
+// 64 bit FNV-1a over file contents; pass the previous result to hash several buffers
+inline uint64_t hashBytes(const std::string_view data,
+                          uint64_t hash = 14695981039346656037ull) noexcept {
+    for (const auto c : data) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
 std::string readEntireFile(const std::filesystem::path& filePath);
 
+// a whole file mapped read only into memory: its pages are read when they are
+// first touched and can be dropped again by the system, so a file larger than
+// the memory available can still be read through view()
+class MappedFile {
+public:
+    explicit MappedFile(const std::filesystem::path& filePath);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const noexcept { return { this->begin, this->size }; }
+
+private:
+    const char* begin = nullptr;
+    std::size_t size = 0;
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+};
+
+// true if every byte is zero; 64 bytes are checked at a time where SSE2 is available
+bool isAllZero(std::string_view data) noexcept;
+
+// two upper case hex digits per byte
+inline void appendHexByte(std::string& destination, const uint8_t byte) {
+    constexpr auto digits = std::string_view{ "0123456789ABCDEF" };
+    destination.push_back(digits[byte >> 4]);
+    destination.push_back(digits[byte & 0xF]);
+}
+
 std::string_view trySplitFront(std::string_view& source,
                                const std::string_view::size_type maxLength) noexcept;
 
 std::string_view splitFront(std::string_view& source,
                             const std::string_view::size_type length);
 
+// byte order of the data being read; this program itself assumes a little endian machine
+enum class Endianness { little, big };
+
 template <typename T>
+T byteSwapped(const T value) noexcept {
+    static_assert(std::is_trivially_copyable_v<T>);
+    auto bytes = std::array<char, sizeof(T)>{};
+    std::memcpy(bytes.data(), &value, sizeof(T));
+    std::reverse(bytes.begin(), bytes.end());
+    auto swapped = T{};
+    std::memcpy(&swapped, bytes.data(), sizeof(T));
+    return swapped;
+}
+
+// reverses each group of width bytes in place, 16 bytes at a time with SSE2 for
+// widths 2 and 4; size must be a multiple of width
+void byteSwapEach(char* data, std::size_t size, std::size_t width) noexcept;
+
+template <typename T, Endianness byteOrder = Endianness::little>
 T readCharsAs(const std::string_view source) {
     static_assert(std::is_trivially_copyable_v<T>);
     if (source.size() != sizeof(T)) {
         throw std::length_error{ "readCharsAs: source.size() != sizeof(T)" };
     }
-    return *reinterpret_cast<const T*>(source.data());
+    // source is not necessarily aligned for T
+    auto value = T{};
+    std::memcpy(&value, source.data(), sizeof(T));
+    if constexpr (byteOrder == Endianness::big and sizeof(T) > 1) {
+        return byteSwapped(value);
+    }
+    else {
+        return value;
+    }
 }
 
-template <typename T>
+template <typename T, Endianness byteOrder = Endianness::little>
 T splitFrontAndReadAs(std::string_view& source) {
     static_assert(std::is_trivially_copyable_v<T>);
-    return readCharsAs<T>(splitFront(source, sizeof(T)));
+    return readCharsAs<T, byteOrder>(splitFront(source, sizeof(T)));
 }
 
 template <typename Array>
@@ -83,31 +170,15 @@ std::string asString(Arguments&&... arguments) {
     return destination.str();
 }
 
+// appends source with & ' " < > replaced by entities; runs without them are
+// found 16 bytes at a time where SSE2 is available and copied at once
+void appendXmlEscaped(std::string& destination, std::string_view source);
+
 inline std::string xmlEscape(const std::string_view src) {
-    auto destination = std::ostringstream{};
-    for (char ch : src) {
-        switch (ch) {
-        case '&':
-            destination << "&amp;";
-            break;
-        case '\'':
-            destination << "&apos;";
-            break;
-        case '"':
-            destination << "&quot;";
-            break;
-        case '<':
-            destination << "&lt;";
-            break;
-        case '>':
-            destination << "&gt;";
-            break;
-        default:
-            destination << ch;
-            break;
-        }
-    }
-    return destination.str();
+    auto destination = std::string{};
+    destination.reserve(src.size());
+    appendXmlEscaped(destination, src);
+    return destination;
 }
 
 inline uint32_t HexToDecimal(const char* str) {
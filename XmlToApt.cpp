@@ -0,0 +1,629 @@
+#include <algorithm>
+#include <cctype>
+#include <ciso646>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#include "AptConstFile.hpp"
+#include "AptEditor.hpp"
+#include "AptTypeDefinitionsParser.hpp"
+#include "AptTypes.hpp"
+#include "ByteBuffer.hpp"
+#include "Util.hpp"
+#include "tinyxml2.h"
+
+namespace Apt::AptEditor {
+
+using namespace AptTypes;
+
+using Element = tinyxml2::XMLElement;
+
+bool elementNameIs(const Element& element, const std::string_view name) {
+    const auto* elementName = element.Name();
+    return elementName != nullptr and elementName == name;
+}
+
+// find the child element which has been created for a member (or compacted into it)
+const Element& findMemberElement(const Element& parent, const std::string_view memberName) {
+    for (auto* child = parent.FirstChildElement(); child != nullptr;
+         child = child->NextSiblingElement()) {
+        if (const auto* name = child->Attribute("name");
+            name != nullptr and memberName == name) {
+            return *child;
+        }
+    }
+    throw std::runtime_error{ asString("Cannot find element for member ", memberName,
+                                       " in ", parent.Name()) };
+}
+
+// array elements are not always in document order after compaction
+std::vector<const Element*> getArrayElements(const Element& array) {
+    auto elements = std::vector<const Element*>{};
+    for (auto* child = array.FirstChildElement(); child != nullptr;
+         child = child->NextSiblingElement()) {
+        elements.emplace_back(child);
+    }
+    const auto byArrayIndex = [](const Element* a, const Element* b) {
+        return a->IntAttribute("arrayIndex") < b->IntAttribute("arrayIndex");
+    };
+    std::stable_sort(elements.begin(), elements.end(), byArrayIndex);
+    return elements;
+}
+
+// inverse of the "\xNN" escaping used by aptToXml for AptHeaderData
+std::string decodeHeaderData(const std::string_view encoded) {
+    auto decoded = std::string{};
+    for (auto i = std::size_t{ 0 }; i < encoded.size(); ++i) {
+        if (encoded.substr(i, 2) == "\\x" and i + 4 <= encoded.size()) {
+            const auto hex = std::string{ encoded.substr(i + 2, 2) };
+            decoded += static_cast<char>(std::stoul(hex, nullptr, 16));
+            i += 3;
+            continue;
+        }
+        decoded += encoded[i];
+    }
+    return decoded;
+}
+
+class XmlAptLayout {
+public:
+    XmlAptLayout(AptObjectPool& pool, const Address firstAddress, const bool deduplicate) :
+        pool{ pool }, cursor{ firstAddress }, deduplicate{ deduplicate } {
+        for (const auto& [baseTypeName, typeData] : pool.types) {
+            if (not typeData.derivedTypes.has_value()) {
+                continue;
+            }
+            const auto& [typeTag, typeMap] = typeData.derivedTypes.value();
+            for (const auto& [typeID, derivedTypeName] : typeMap) {
+                this->derivedTypeIDs.emplace(derivedTypeName,
+                                             DerivedTypeID{ baseTypeName, typeTag, typeID });
+            }
+        }
+    }
+
+    Address placeEntryPoint(const Element& movie) {
+        this->entryAddress = this->nextAddress();
+        return this->placeObject(movie, "Character");
+    }
+
+    Address endAddress() const noexcept { return this->cursor; }
+
+    std::size_t reusedCount() const noexcept { return this->reused; }
+    std::size_t savedBytes() const noexcept { return this->saved; }
+
+private:
+    struct DerivedTypeID {
+        std::string baseTypeName;
+        std::string typeTag;
+        std::uint32_t typeID;
+    };
+
+    // a branch or a function body whose destination is only known after
+    // the whole instruction stream has been laid out
+    struct Relocation {
+        AptType* instruction;
+        Address instructionAddress;
+        std::string member;
+        Address originalDestination;
+    };
+
+    using SkippedMembers = std::vector<std::string>;
+
+    Address nextAddress() const noexcept {
+        return (this->cursor + 3) / 4 * 4;
+    }
+
+    // replace prototype with its derived type named in the type tag attribute,
+    // and fill in the type tags (which are written as type names in xml)
+    AptType resolveDerivedType(const Element& element,
+                               const AptType& prototype,
+                               SkippedMembers& skipped) const {
+        const auto typeData = this->pool.types.find(prototype.typeName);
+        if (typeData == this->pool.types.end() or
+            not typeData->second.derivedTypes.has_value()) {
+            return prototype;
+        }
+
+        const auto& typeTag = typeData->second.derivedTypes->typeTag;
+        const auto* derivedTypeName = element.Attribute(typeTag.c_str());
+        if (derivedTypeName == nullptr) {
+            throw std::runtime_error{ asString("Missing derived type of ",
+                                               prototype.typeName) };
+        }
+
+        auto derived = this->pool.getType(derivedTypeName);
+        if (not this->pool.isSameOrDerivedFrom(derived, prototype.typeName)) {
+            throw std::runtime_error{ asString(derivedTypeName, " is not derived from ",
+                                               prototype.typeName) };
+        }
+
+        for (auto current = this->derivedTypeIDs.find(derived.typeName);
+             current != this->derivedTypeIDs.end();
+             current = this->derivedTypeIDs.find(current->second.baseTypeName)) {
+            const auto& [baseTypeName, tag, typeID] = current->second;
+            derived.at(tag).setNumericValue(typeID);
+            skipped.emplace_back(tag);
+        }
+        return derived;
+    }
+
+    template <typename T>
+    static T readAttribute(const Element& element, const char* name) {
+        auto value = T{};
+        auto result = tinyxml2::XML_NO_ATTRIBUTE;
+        if constexpr (std::is_same_v<T, float>) {
+            result = element.QueryFloatAttribute(name, &value);
+        }
+        else if constexpr (std::is_signed_v<T>) {
+            result = element.QueryIntAttribute(name, &value);
+        }
+        else {
+            result = element.QueryUnsignedAttribute(name, &value);
+        }
+
+        if (result != tinyxml2::XML_SUCCESS) {
+            throw std::runtime_error{ asString("Cannot read attribute ", name, " of ",
+                                               element.Name()) };
+        }
+        return value;
+    }
+
+    // sizing pass of a single object: read every value stored in attributes and
+    // compute paddings; pointers are left to resolveReferences
+    void readValues(const Element& element,
+                    AptType& object,
+                    const std::string& name,
+                    Address& position,
+                    const SkippedMembers& skipped) const {
+        const auto* attributeName = name.empty() ? "value" : name.c_str();
+        const auto isSkipped =
+            std::find(skipped.begin(), skipped.end(), name) != skipped.end();
+
+        const auto visitor = [&](auto& value) {
+            using Type = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<Type, AptType::MemberArray>) {
+                for (auto& [memberName, member] : value) {
+                    if (std::holds_alternative<AptType::MemberArray>(member.value)) {
+                        auto nextSkipped = SkippedMembers{};
+                        auto& memberElement = findMemberElement(element, memberName);
+                        member = this->resolveDerivedType(memberElement, member, nextSkipped);
+                        this->readValues(memberElement, member, {}, position, nextSkipped);
+                        continue;
+                    }
+                    this->readValues(element, member, memberName, position, skipped);
+                }
+                return;
+            }
+            else if constexpr (std::is_same_v<Type, PaddingForAlignment>) {
+                value.actuallyPadded = (value.align - position % value.align) % value.align;
+            }
+            else if constexpr (std::is_same_v<Type, std::string>) {
+                const auto* text = element.Attribute(attributeName);
+                if (text == nullptr) {
+                    throw std::runtime_error{ asString("Cannot read attribute ",
+                                                       attributeName, " of ",
+                                                       element.Name()) };
+                }
+                value = text;
+            }
+            else if constexpr (std::is_same_v<Type, Unsigned24>) {
+                if (not isSkipped) {
+                    value.value = readAttribute<unsigned>(element, attributeName) & 0xFFFFFF;
+                }
+            }
+            else if constexpr (std::is_same_v<Type, float>) {
+                if (not isSkipped) {
+                    value = readAttribute<float>(element, attributeName);
+                }
+            }
+            else if constexpr (std::is_arithmetic_v<Type>) {
+                // actionDataOffset is resolved after its instructions are laid out
+                if (not isSkipped and name != "actionDataOffset") {
+                    using Read = std::conditional_t<std::is_signed_v<Type>, int, unsigned>;
+                    value = static_cast<Type>(readAttribute<Read>(element, attributeName));
+                }
+            }
+        };
+        std::visit(visitor, object.value);
+
+        if (not std::holds_alternative<AptType::MemberArray>(object.value)) {
+            position += object.size();
+        }
+    }
+
+    AptType readObject(const Element& element,
+                       const AptType& prototype,
+                       const Address address,
+                       SkippedMembers skipped = {}) const {
+        auto object = this->resolveDerivedType(element, prototype, skipped);
+        auto position = address;
+        this->readValues(element, object, {}, position, skipped);
+        return object;
+    }
+
+    Address resolvePointer(const Element& target, const std::string& typePointedTo) {
+        if (not elementNameIs(target, "Ref")) {
+            return this->placeObject(target, typePointedTo);
+        }
+
+        const auto* type = target.Attribute("type");
+        const auto refType = std::string_view{ type == nullptr ? "" : type };
+        if (refType == "Null" or refType == "EmptyArray") {
+            return 0;
+        }
+        if (refType == "AptMovieEntryPointPointer") {
+            return this->entryAddress;
+        }
+        if (const auto* actionDataOffset = target.Attribute("actionDataOffset");
+            actionDataOffset != nullptr and
+            target.UnsignedAttribute("actionDataOffset") == 0) {
+            return 0;
+        }
+        throw std::runtime_error{ asString("Unresolved reference ",
+                                           target.Attribute("name") == nullptr
+                                               ? "" : target.Attribute("name")) };
+    }
+
+    // place objects referenced by object, right after everything laid out so far
+    void resolveReferences(const Element& element, AptType& object) {
+        if (std::holds_alternative<AptTypePointer>(object.value)) {
+            auto& pointer = std::get<AptTypePointer>(object.value);
+            pointer.address = this->resolvePointer(element, pointer.typePointedTo);
+            return;
+        }
+
+        if (not std::holds_alternative<AptType::MemberArray>(object.value)) {
+            return;
+        }
+
+        for (auto& [memberName, member] : std::get<AptType::MemberArray>(object.value)) {
+            if (memberName == "actionDataOffset") {
+                const auto& target = findMemberElement(element, memberName);
+                member.setNumericValue(elementNameIs(target, "Ref")
+                                           ? this->resolvePointer(target, {})
+                                           : this->placeInstructions(target));
+                continue;
+            }
+
+            if (std::holds_alternative<AptType::MemberArray>(member.value) or
+                std::holds_alternative<AptTypePointer>(member.value)) {
+                this->resolveReferences(findMemberElement(element, memberName), member);
+            }
+            else if (std::holds_alternative<PointerToArray>(member.value)) {
+                auto& array = std::get<PointerToArray>(member.value);
+                const auto& target = findMemberElement(element, memberName);
+                if (elementNameIs(target, "Ref")) {
+                    array.length = 0;
+                    array.pointerToArray.address = this->resolvePointer(target, {});
+                }
+                else {
+                    const auto elements = getArrayElements(target);
+                    array.length = elements.size();
+                    array.pointerToArray.address =
+                        this->placeArray(elements, array.pointerToArray.typePointedTo);
+                }
+                // keep length in sync with the array actually written
+                object.at(array.arraySizeVariable).setNumericValue(array.length);
+            }
+        }
+    }
+
+    // the bytes objects are written as, pointers included, prefixed by their type
+    static std::string deduplicationKey(const std::vector<const AptType*>& objects) {
+        auto buffer = ByteBuffer{};
+        const auto visitor = [&buffer](const auto& value, const AptType::NameStack&) {
+            using Type = std::decay_t<decltype(value)>;
+            if constexpr (std::is_arithmetic_v<Type>) {
+                buffer.append(value);
+            }
+            else if constexpr (std::is_same_v<Type, Unsigned24>) {
+                buffer.append(value.value);
+            }
+            else if constexpr (std::is_same_v<Type, std::string>) {
+                buffer.appendBytes(value.data(), value.size() + 1);
+            }
+            else if constexpr (std::is_same_v<Type, AptTypePointer>) {
+                buffer.append(value.address);
+            }
+            else if constexpr (std::is_same_v<Type, PointerToArray>) {
+                buffer.append(value.pointerToArray.address);
+            }
+            else if constexpr (std::is_same_v<Type, PaddingForAlignment>) {
+                buffer.append(value.actuallyPadded);
+            }
+        };
+        for (const auto* object : objects) {
+            buffer.appendBytes(object->typeName.data(), object->typeName.size() + 1);
+            object->forEachRecursive(visitor);
+        }
+        return std::string{ buffer.view() };
+    }
+
+    // Characters are told apart by their address at runtime, and Sprite, Movie and
+    // Import have fields the game fills in once loaded, so two of them must never be
+    // one object; only the plain data below them (strings, vertices and triangles,
+    // action streams...) is shared.
+    bool isShareable(const AptType& object) const {
+        return not this->pool.isSameOrDerivedFrom(object, "Character") and
+               not this->pool.isSameOrDerivedFrom(object, "Import");
+    }
+
+    // With deduplicate, objects just laid out in [begin, headEnd) which are the same
+    // as ones laid out before are dropped, and the earlier copy is returned instead.
+    // Identical children have already been shared by then, so identical subtrees
+    // end up with identical heads, pointers included.
+    std::optional<Address> reuseIdentical(std::string key,
+                                          const Address begin,
+                                          const Address headEnd,
+                                          const Address cursorBefore) {
+        if (not this->deduplicate) {
+            return std::nullopt;
+        }
+        const auto [existing, inserted] = this->placedHeads.try_emplace(std::move(key), begin);
+        // anything laid out after the head means the head points to new objects
+        if (inserted or this->cursor != headEnd) {
+            return std::nullopt;
+        }
+        this->cursor = cursorBefore;
+        this->reused += 1;
+        this->saved += headEnd - cursorBefore;
+        return existing->second;
+    }
+
+    Address placeObject(const Element& element, const std::string& typeName) {
+        const auto cursorBefore = this->cursor;
+        const auto address = this->nextAddress();
+        auto object = this->readObject(element, this->pool.getType(typeName), address);
+        this->cursor = address + object.size();
+        const auto headEnd = this->cursor;
+        this->resolveReferences(element, object);
+        if (this->isShareable(object)) {
+            if (const auto existing = this->reuseIdentical(
+                    deduplicationKey({ &object }), address, headEnd, cursorBefore)) {
+                return existing.value();
+            }
+        }
+        this->pool.insertObject(std::move(object), address);
+        return address;
+    }
+
+    Address placeArray(const std::vector<const Element*>& elements,
+                       const std::string& elementTypeName) {
+        if (elements.empty()) {
+            return 0;
+        }
+
+        const auto prototype = this->pool.getType(elementTypeName);
+        const auto elementSize = prototype.size();
+        const auto cursorBefore = this->cursor;
+        const auto begin = this->nextAddress();
+
+        auto objects = std::vector<AptType>{};
+        for (auto i = std::size_t{ 0 }; i < elements.size(); ++i) {
+            objects.emplace_back(
+                this->readObject(*elements[i], prototype, begin + i * elementSize));
+            if (objects.back().size() != elementSize) {
+                throw std::runtime_error{ asString("Array element of type ",
+                                                   elementTypeName,
+                                                   " does not have a fixed size") };
+            }
+        }
+        const auto end = static_cast<Address>(begin + elements.size() * elementSize);
+        this->cursor = end;
+
+        auto heads = std::vector<const AptType*>{};
+        for (auto i = std::size_t{ 0 }; i < elements.size(); ++i) {
+            this->resolveReferences(*elements[i], objects[i]);
+            heads.emplace_back(&objects[i]);
+        }
+        if (this->isShareable(prototype)) {
+            if (const auto existing =
+                    this->reuseIdentical(deduplicationKey(heads), begin, end, cursorBefore)) {
+                return existing.value();
+            }
+        }
+        for (auto i = std::size_t{ 0 }; i < elements.size(); ++i) {
+            this->pool.insertObject(std::move(objects[i]), begin + i * elementSize);
+        }
+        this->pool.insertArrayData(begin, end);
+        return begin;
+    }
+
+    Address placeInstructions(const Element& stream) {
+        const auto elements = getArrayElements(stream);
+        const auto prototype = this->pool.getType("Instruction");
+        const auto cursorBefore = this->cursor;
+        const auto begin = this->nextAddress();
+
+        auto instructions = std::vector<std::pair<Address, AptType>>{};
+        // original address -> (new address, instruction index)
+        auto addressMap = std::map<Address, std::pair<Address, std::size_t>>{};
+        auto position = begin;
+        for (const auto* element : elements) {
+            const auto* typeName = element->Attribute("type");
+            const auto type = std::string_view{ typeName == nullptr ? "" : typeName };
+            auto skipped = SkippedMembers{};
+            if (type.find("Branch") == 0) {
+                skipped.emplace_back("offset");
+            }
+            if (type.find("DefineFunction") == 0) {
+                skipped.emplace_back("size");
+            }
+
+            auto instruction = this->readObject(*element, prototype, position, skipped);
+            if (const auto* originalAddress = element->Attribute("address");
+                originalAddress != nullptr) {
+                addressMap.emplace(element->UnsignedAttribute("address"),
+                                   std::pair{ position, instructions.size() });
+            }
+            const auto size = instruction.size();
+            instructions.emplace_back(position, std::move(instruction));
+            position += size;
+        }
+        this->cursor = position;
+
+        auto relocations = std::vector<Relocation>{};
+        for (auto i = std::size_t{ 0 }; i < elements.size(); ++i) {
+            auto& [address, instruction] = instructions[i];
+            this->resolveReferences(*elements[i], instruction);
+            if (instruction.typeName.find("Branch") == 0) {
+                relocations.push_back(Relocation{
+                    &instruction, address, "offset",
+                    elements[i]->UnsignedAttribute("destinationAddress") });
+            }
+            if (instruction.typeName.find("DefineFunction") == 0) {
+                relocations.push_back(Relocation{
+                    &instruction, address, "size",
+                    elements[i]->UnsignedAttribute("lastInstructionStartAddress") });
+            }
+        }
+
+        for (const auto& [instruction, address, member, destination] : relocations) {
+            const auto found = addressMap.find(destination);
+            if (found == addressMap.end()) {
+                throw std::runtime_error{ asString(
+                    "Unknown branch destination ", destination, " of ",
+                    instruction->typeName, " (xml exported without instruction address?)") };
+            }
+            const auto& [newDestination, index] = found->second;
+            const auto nextInstruction = address + instruction->size();
+            // function size counts up to the end of its last instruction
+            const auto endOfDestination =
+                member == "size" ? newDestination + instructions[index].second.size()
+                                 : newDestination;
+            instruction->at(member).setNumericValue(
+                static_cast<AddressDifference>(endOfDestination - nextInstruction));
+        }
+
+        auto heads = std::vector<const AptType*>{};
+        for (const auto& [address, instruction] : instructions) {
+            heads.emplace_back(&instruction);
+        }
+        if (const auto existing =
+                this->reuseIdentical(deduplicationKey(heads), begin, position, cursorBefore)) {
+            return existing.value();
+        }
+        for (auto& [address, instruction] : instructions) {
+            this->pool.insertObject(std::move(instruction), address);
+        }
+        this->pool.insertArrayData(begin, position);
+        return begin;
+    }
+
+    AptObjectPool& pool;
+    Address cursor;
+    Address entryAddress = 0;
+    std::map<std::string, DerivedTypeID, std::less<>> derivedTypeIDs;
+
+    bool deduplicate;
+    // deduplicationKey of every head laid out -> its address
+    std::unordered_map<std::string, Address> placedHeads;
+    std::size_t reused = 0;
+    std::size_t saved = 0;
+};
+
+std::filesystem::path xmlToApt(const std::filesystem::path& xmlFileName,
+                               const XmlToAptOptions& options) {
+    // foo.apt.edited.xml -> foo
+    auto baseName = std::filesystem::path{ xmlFileName }.replace_extension();
+    for (const auto* extension : { ".edited", ".apt" }) {
+        if (baseName.extension() == extension) {
+            baseName.replace_extension();
+        }
+    }
+    const auto originalConstFileName = std::filesystem::path{ baseName }.concat(".const");
+    const auto aptFileName = std::filesystem::path{ baseName }.concat(".edited.apt");
+    const auto constFileName = std::filesystem::path{ baseName }.concat(".edited.const");
+
+    auto xml = tinyxml2::XMLDocument{};
+    if (xml.LoadFile(xmlFileName.string().c_str()) != tinyxml2::XML_SUCCESS) {
+        throw std::runtime_error{ asString("Failed to parse ", xmlFileName.string(), ": ",
+                                           xml.GetErrorStr1()) };
+    }
+
+    auto* aptDataNode = xml.FirstChildElement("ParsedAptData");
+    if (aptDataNode == nullptr) {
+        throw std::runtime_error{ "ParsedAptData not found" };
+    }
+    if (aptDataNode->Attribute("rootAddress") != nullptr) {
+        throw std::runtime_error{ xmlFileName.string() +
+                                  " holds a single character and cannot be converted back" };
+    }
+    const auto* headerNode = aptDataNode->FirstChildElement("AptHeaderData");
+    if (headerNode == nullptr or headerNode->Attribute("value") == nullptr) {
+        throw std::runtime_error{ "AptHeaderData not found" };
+    }
+    const auto* movieNode = headerNode->NextSiblingElement("Character");
+    if (movieNode == nullptr) {
+        throw std::runtime_error{ "Movie not found" };
+    }
+
+    auto pool = AptObjectPool{};
+    loadTypeDefinitions(pool);
+
+    const auto header = decodeHeaderData(headerNode->Attribute("value"));
+    auto constData = ConstFile::ConstData{ readEntireFile(originalConstFileName) };
+
+    // the savings are told by laying out the movie as written first
+    auto unoptimizedSize = Address{ 0 };
+    if (options.optimize or options.internStrings) {
+        auto unoptimizedPool = pool;
+        auto unoptimized = XmlAptLayout{ unoptimizedPool, static_cast<Address>(header.size()),
+                                         options.deduplicate };
+        unoptimized.placeEntryPoint(*movieNode);
+        unoptimizedSize = unoptimized.endAddress();
+    }
+    if (options.optimize) {
+        const auto optimization = optimizeActions(*aptDataNode, constData);
+        std::cout << "Optimized " << optimization.streams << " action streams from "
+                  << optimization.instructionsBefore << " to "
+                  << optimization.instructionsAfter << " instructions" << std::endl;
+    }
+    if (options.internStrings) {
+        const auto interning = internStrings(*aptDataNode, constData);
+        std::cout << "Replaced " << interning.rewrittenInstructions
+                  << " inline strings with .const items, " << interning.addedStrings
+                  << " of them new" << std::endl;
+    }
+
+    // sizing pass: every object gets its address and pointers are resolved
+    auto layout =
+        XmlAptLayout{ pool, static_cast<Address>(header.size()), options.deduplicate };
+    const auto entryOffset = layout.placeEntryPoint(*movieNode);
+    if (options.deduplicate) {
+        std::cout << "Shared " << layout.reusedCount() << " duplicated objects, saving "
+                  << layout.savedBytes() << " bytes" << std::endl;
+    }
+    if (options.optimize or options.internStrings) {
+        std::cout << "The .apt is " << static_cast<std::int64_t>(unoptimizedSize) -
+                                           static_cast<std::int64_t>(layout.endAddress())
+                  << " bytes smaller" << std::endl;
+    }
+
+    // emit pass
+    auto output = DataDestination{};
+    output.data.resize(layout.endAddress());
+    output.getViewAt(0).writeFront(header);
+    pool.writeAllObjects(output);
+
+    constData.aptDataOffset = entryOffset;
+    // the .apt was just written little endian, whatever the original was
+    constData.endianness = Endianness::little;
+
+    auto aptOutput = std::ofstream{ aptFileName, std::ios::binary };
+    aptOutput.write(output.data.data(), output.data.size());
+    const auto constBytes = constData.toBytes();
+    auto constOutput = std::ofstream{ constFileName, std::ios::binary };
+    constOutput.write(constBytes.data(), constBytes.size());
+    return aptFileName;
+}
+} // namespace Apt::AptEditor
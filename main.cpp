@@ -2,10 +2,15 @@
 #ifndef DLL_PROJECT
 #include "Aptfile.hpp"
 #include "AptEditor.hpp"
+#include <algorithm>
+#include <cctype>
+#include <thread>
+#include <vector>
 
 int main(int argc, char** argv)
 {
 	std::string filename;
+	std::vector<std::string> options;
 	switch(argc)
 	{
 	case 1:
@@ -14,17 +19,111 @@ int main(int argc, char** argv)
 		std::cin >> filename;
 		break;
 	}
-	case 2:
+	default:
 	{		
 		filename = argv[1];
+		options.assign(argv + 2, argv + argc);
 		break;
 	}
-	default:
-		break;
 	}
 
+	// --snapshot: write a binary .aptsnap instead of .xml / .apt
+	// --apt: convert an .aptsnap back to .apt instead of .xml
+	// --cache: reuse the parsed pool from <apt>.aptcache when converting .apt to .xml
+	// --exports: only list the exports of an .apt file, reading just what they point to
+	// --character <index or export name>: write only that character of an .apt file to .xml
+	// --set <path>=<value>: patch one number or string of an .apt file, see patchApt
+	// --diff <other .apt>: list the characters, frames and actions which differ
+	// --duplicates: list the subtrees of an .apt file which appear more than once
+	// --bench: time escaping the strings and formatting the numbers of an .apt file
+	// --check-server: run a scripted session of --serve on copies of an .apt file
+	// --strip: write an .apt file without the characters nothing leads to, see stripApt
+	// --dedup: when converting .xml to .apt, write identical subtrees only once
+	// --optimize: when converting .xml to .apt, shorten the action streams, see optimizeActions
+	// --intern: when converting .xml to .apt, move inline action strings to the .const, see internStrings
+	// --stream [<megabytes>]: convert .apt to .xml one character at a time, see aptToXmlStreaming
+	const auto hasOption = [&options](const std::string& option) {
+		return std::find(options.begin(), options.end(), option) != options.end();
+	};
+	const auto optionValue = [&options](const std::string& option) {
+		const auto found = std::find(options.begin(), options.end(), option);
+		if (found == options.end() || std::next(found) == options.end())
+			return std::string{};
+		return *std::next(found);
+	};
+
 	try {
-        Apt::AptEditor::aptToXml(filename);
+        // --serve: answer requests from stdin until "quit", see AptServer.cpp
+        if (filename == "--serve") {
+            Apt::AptEditor::serve(std::cin, std::cout, std::thread::hardware_concurrency());
+            return 0;
+        }
+        const auto extension = std::filesystem::path{ filename }.extension();
+        if (extension == ".aptsnap") {
+            if (hasOption("--apt")) {
+                Apt::AptEditor::snapshotToApt(filename);
+            }
+            else {
+                Apt::AptEditor::snapshotToXml(filename);
+            }
+        }
+        else if (extension == ".xml") {
+            if (hasOption("--snapshot")) {
+                Apt::AptEditor::xmlToSnapshot(filename);
+            }
+            else {
+                auto xmlOptions = Apt::AptEditor::XmlToAptOptions{};
+                xmlOptions.deduplicate = hasOption("--dedup");
+                xmlOptions.optimize = hasOption("--optimize");
+                xmlOptions.internStrings = hasOption("--intern");
+                Apt::AptEditor::xmlToApt(filename, xmlOptions);
+            }
+        }
+        else if (hasOption("--bench")) {
+            Apt::AptEditor::benchmarkXmlText(filename);
+        }
+        else if (hasOption("--check-server")) {
+            Apt::AptEditor::checkServer(filename);
+        }
+        else if (hasOption("--strip")) {
+            Apt::AptEditor::stripApt(filename);
+        }
+        else if (hasOption("--duplicates")) {
+            Apt::AptEditor::printDuplicates(filename);
+        }
+        else if (hasOption("--diff")) {
+            Apt::AptEditor::diffApt(filename, optionValue("--diff"), std::cout);
+        }
+        else if (hasOption("--set")) {
+            const auto assignment = optionValue("--set");
+            const auto separator = assignment.find('=');
+            if (separator == std::string::npos)
+                throw std::invalid_argument{ "--set expects <path>=<value>" };
+            const auto result = Apt::AptEditor::patchApt(
+                filename, assignment.substr(0, separator), assignment.substr(separator + 1));
+            std::cout << (result.inPlace ? "Patched " : "Rewrote ") << result.fileName
+                      << std::endl;
+        }
+        else if (hasOption("--character")) {
+            Apt::AptEditor::characterToXml(filename, optionValue("--character"));
+        }
+        else if (hasOption("--exports")) {
+            Apt::AptEditor::printExports(filename);
+        }
+        else if (hasOption("--snapshot")) {
+            Apt::AptEditor::aptToSnapshot(filename);
+        }
+        else if (hasOption("--stream")) {
+            const auto megabytes = optionValue("--stream");
+            const auto isNumber = not megabytes.empty() and
+                std::all_of(megabytes.begin(), megabytes.end(),
+                            [](const unsigned char c) { return std::isdigit(c) != 0; });
+            const auto memoryLimit = isNumber ? std::stoull(megabytes) : 512;
+            Apt::AptEditor::aptToXmlStreaming(filename, memoryLimit << 20);
+        }
+        else {
+            Apt::AptEditor::aptToXml(filename, hasOption("--cache"));
+        }
     }
 	catch(const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;